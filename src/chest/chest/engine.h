@@ -15,7 +15,9 @@
 #include <thread>
 
 #include "libChest/eval.h"
+#include "libChest/perft.h"
 #include "libChest/search.h"
+#include "libChest/timemanagement.h"
 #include "libChest/util.h"
 
 constexpr size_t MAX_DEPTH = 64;
@@ -107,6 +109,11 @@ class GenericEngine : public search::StatReporter {
     auto &get_searcher() { return m_searcher; }
     const auto &get_searcher() const { return m_searcher; }
 
+    auto &get_perft() { return m_perft; }
+
+    // Stops the searcher at its deadline
+    auto &get_watchdog() { return m_watchdog; }
+
     bool is_debug() const { return m_debug; }
 
     //-- Mutators ------------------------------------------------------------//
@@ -142,10 +149,14 @@ class GenericEngine : public search::StatReporter {
     search::TTable m_ttable{};
 
     using EvalTp = eval::DefaultEval;
-    using DlSearcherTp = search::DLNegaMax<EvalTp, MAX_DEPTH>;
-    using IDSearcherTp = search::IDSearcher<DlSearcherTp, MAX_DEPTH>;
+    using SearcherTp = search::LazySMPSearcher<EvalTp, MAX_DEPTH>;
+
+    SearcherTp m_searcher{m_node, m_ttable};
+
+    state::ParallelPerft<MAX_DEPTH> m_perft{};
 
-    IDSearcherTp m_searcher{m_node, m_ttable};
+    // After m_searcher, so it is destroyed (and stops firing) first
+    search::Watchdog m_watchdog{[this]() { m_searcher.stop(); }};
 
     std::shared_ptr<std::thread> m_worker = nullptr;
 
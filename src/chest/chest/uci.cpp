@@ -112,6 +112,55 @@ bool UCICheckOption::parse(std::string_view opt_name,
 std::optional<int> Hash::execute() {
     if (m_engine->check_not_busy()) {
         m_engine->get_ttable().resize_mb(m_set_val);
+        m_engine->get_perft().set_hash_mb(m_set_val);
+    }
+    return {};
+}
+
+//-- Threads -----------------------------------------------------------------//
+
+std::optional<int> Threads::execute() {
+    if (m_engine->check_not_busy()) {
+        m_engine->get_searcher().set_threads(m_set_val);
+        m_engine->get_perft().set_threads(m_set_val);
+    }
+    return {};
+}
+
+//-- MultiPV -----------------------------------------------------------------//
+
+std::optional<int> MultiPV::execute() {
+    if (m_engine->check_not_busy()) {
+        m_engine->get_searcher().set_multipv(m_set_val);
+    }
+    return {};
+}
+
+//-- PerftSplitDepth ---------------------------------------------------------//
+
+std::optional<int> PerftSplitDepth::execute() {
+    if (m_engine->check_not_busy()) {
+        m_engine->get_perft().set_split_depth(m_set_val);
+    }
+    return {};
+}
+
+//-- Search margins ----------------------------------------------------------//
+
+std::optional<int> ProbCutMargin::execute() {
+    if (m_engine->check_not_busy()) {
+        search::SearchParams params = m_engine->get_searcher().get_params();
+        params.probcut_margin = m_set_val;
+        m_engine->get_searcher().set_params(params);
+    }
+    return {};
+}
+
+std::optional<int> SingularMargin::execute() {
+    if (m_engine->check_not_busy()) {
+        search::SearchParams params = m_engine->get_searcher().get_params();
+        params.singular_margin = m_set_val;
+        m_engine->get_searcher().set_params(params);
     }
     return {};
 }
@@ -323,6 +372,18 @@ void Go::register_fields() {
             m_depth = MAX_DEPTH;
         };
     };
+    m_fields["nodes"] = [this](const std::string_view keyword,
+                               std::stringstream &args) {
+        return parse_field(keyword, args, m_nodes);
+    };
+    m_fields["mate"] = [this](const std::string_view keyword,
+                              std::stringstream &args) {
+        return parse_field(keyword, args, m_mate);
+    };
+    m_fields["searchmoves"] = [this](const std::string_view keyword,
+                                     std::stringstream &args) {
+        return search_moves_impl(keyword, args);
+    };
     m_fields["movestogo"] =
         [this](const std::string_view keyword, std::stringstream &args
 
@@ -336,6 +397,25 @@ void Go::register_fields() {
         m_type = SearchType::PERFT;
         return parse_field(keyword, args, m_depth);
     };
+    // Perft speedups (see state::PerftOptions)
+    m_fields["bulk"] = [this](const std::string_view keyword,
+                              std::stringstream &args) {
+        (void)keyword;
+        (void)args;
+        m_perft_opts.bulk = true;
+    };
+    m_fields["hash"] = [this](const std::string_view keyword,
+                              std::stringstream &args) {
+        (void)keyword;
+        (void)args;
+        m_perft_opts.hash = true;
+    };
+    m_fields["legal"] = [this](const std::string_view keyword,
+                               std::stringstream &args) {
+        (void)keyword;
+        (void)args;
+        m_perft_opts.legal = true;
+    };
     m_fields["ab"] = [this](const std::string_view keyword,
                             std::stringstream &args) {
         (void)keyword;
@@ -382,12 +462,51 @@ void Go::parse_field(const std::string_view keyword, std::stringstream &args,
     field = val;
 }
 
+// Reads moves until the next token which does not start with two squares.
+// Tokens which do, but are not moves, are reported and skipped.
+void Go::search_moves_impl(const std::string_view keyword,
+                           std::stringstream &args) {
+    static constexpr size_t movestr_len = 4;
+    std::streampos pos = args.tellg();
+    std::string arg;
+    while (args >> arg) {
+        bool squares = arg.size() >= movestr_len;
+        try {
+            if (squares) {
+                (void)board::io::to_square(arg.substr(0, 2));
+                (void)board::io::to_square(arg.substr(2, 2));
+            }
+        } catch (std::invalid_argument &e) {
+            (void)e;
+            squares = false;
+        }
+        if (!squares) {
+            args.seekg(pos);  // the next keyword
+            return;
+        }
+
+        std::optional<move::FatMove> mv{};
+        try {
+            mv = move::LongAlgMove{arg}.to_fmove(m_engine->get_astate());
+        } catch (std::invalid_argument &e) {
+            (void)e;  // not a promotion piece, reported below
+        }
+        if (mv.has_value()) {
+            m_search_moves.push_back(mv.value());
+        } else {
+            bad_arg(keyword, arg);
+        }
+        pos = args.tellg();
+    }
+}
+
 bool Go::sufficient_args() const {
     if (!m_engine->check_not_busy()) {
         return false;
     };
     const board::Colour to_move = m_engine->get_astate().state.to_move;
-    return m_tc.movetime || m_tc.copy_remaining(to_move) || m_depth;
+    return m_tc.movetime || m_tc.copy_remaining(to_move) || m_depth ||
+           m_nodes || m_mate;
 }
 
 std::optional<int> Go::execute() {
@@ -414,6 +533,10 @@ std::optional<int> Go::execute_impl() {
         .depth = m_depth,
         .bounds = m_bounds,
         .tc = m_tc,
+        .nodes = m_nodes ? std::optional(m_nodes) : std::nullopt,
+        .mate = m_mate ? std::optional(m_mate) : std::nullopt,
+        .search_moves = m_search_moves,
+        .perft_opts = m_perft_opts,
         // Set to null if not pondering
         .p_ponderhit_finish_time = m_ponder ? p_ponderhit_finish_time : nullptr};
 
@@ -426,42 +549,56 @@ std::optional<int> Go::execute_impl() {
             m_engine->get_worker() = std::make_shared<std::thread>(
                 search_impl<Verbosity, SearchType::AB>, args);
             return {};
-            // TODO: async perft
         case SearchType::PERFT:
-            return perft_impl();
+            m_engine->get_worker() =
+                std::make_shared<std::thread>(perft_impl, args);
+            return {};
     }
 }
 
-std::optional<int> Go::perft_impl() {
-    state::PerftNode<MAX_DEPTH> sn{m_engine->get_astate(), m_depth};
-    const auto moves = sn.find_moves<false>();
-    size_t perft = 0;
+void Go::perft_impl(SearchArgs args) {
+    args.eng->set_busy();
 
-    for (auto m : moves) {
-        if (sn.make_move(m)) {
-            const auto mv_res = sn.perft().perft;
-            perft += mv_res;
+    auto &parallel = args.eng->get_perft();
+    const state::AugmentedState &astate = args.eng->get_astate();
+    const state::PerftOptions opts = args.perft_opts;
+    const auto divide_with = [&]<bool Legal>() {
+        return opts.bulk && opts.hash
+                   ? parallel.divide<{.bulk = true, .hash = true,
+                                      .legal = Legal}>(astate, args.depth)
+               : opts.bulk
+                   ? parallel.divide<{.bulk = true, .legal = Legal}>(
+                         astate, args.depth)
+               : opts.hash
+                   ? parallel.divide<{.hash = true, .legal = Legal}>(
+                         astate, args.depth)
+                   : parallel.divide<{.legal = Legal}>(astate, args.depth);
+    };
+    const auto divide = opts.legal ? divide_with.operator()<true>()
+                                   : divide_with.operator()<false>();
+    if (!divide.has_value()) {
+        args.eng->log("perft stopped\n", LogLevel::ENGINE_WARN, true);
+        args.eng->set_busy(false);
+        return;
+    }
 
-            // Need to_move to reset to convert castles to long algebraic
-            // notation correctly
-            sn.unmake_move();
+    size_t perft = 0;
+    for (const auto &[m, mv_res] : divide.value()) {
+        perft += mv_res;
 
-            std::string partial_msg = move::LongAlgMove(m);
-            partial_msg.append(": ");
-            partial_msg.append(std::to_string(mv_res));
-            partial_msg.push_back('\n');
+        std::string partial_msg = move::LongAlgMove(m);
+        partial_msg.append(": ");
+        partial_msg.append(std::to_string(mv_res));
+        partial_msg.push_back('\n');
 
-            m_engine->log(partial_msg, LogLevel::ENGINE_INFO, true);
-        } else {
-            sn.unmake_move();
-        }
+        args.eng->log(partial_msg, LogLevel::ENGINE_INFO, true);
     }
 
     std::string msg = "Result: ";
     msg.append(std::to_string(perft));
     msg.push_back('\n');
-    m_engine->log(msg, LogLevel::ENGINE_INFO);
-    return {};
+    args.eng->log(msg, LogLevel::ENGINE_INFO, true);
+    args.eng->set_busy(false);
 };
 
 template <search::VerbosityLevel Verbosity, Go::SearchType SearchType>
@@ -472,26 +609,25 @@ void Go::search_impl(SearchArgs args) {
 
     args.eng->set_busy();
 
-    const search::DefaultTimeManager time_manager{};
-    const search::ms_t search_time =
-        time_manager(args.tc, args.eng->get_astate().state.to_move);
-
+    // Soft limit is checked by the searcher, hard limit by the watchdog
+    auto &time_manager = args.eng->get_searcher().get_time_manager();
+    time_manager.start(args.tc, args.eng->get_astate().state.to_move,
+                       args.p_ponderhit_finish_time != nullptr);
     const std::optional<std::chrono::time_point<std::chrono::steady_clock>>
-        finish_time =
-            args.tc.is_null()
-                ? std::nullopt
-                : std::optional(std::chrono::steady_clock::now() +
-                                std::chrono::milliseconds(search_time));
+        finish_time = time_manager.hard_deadline();
 
-    if (args.depth) {
-        args.eng->get_searcher().set_depth(args.depth);
-    }
+    // Searches limited otherwise (or infinite) are not limited by depth
+    args.eng->get_searcher().set_depth(args.depth ? args.depth : MAX_DEPTH);
+    args.eng->get_searcher().set_node_limit(args.nodes);
+    args.eng->get_searcher().set_mate_limit(args.mate);
+    args.eng->get_searcher().set_search_moves(args.search_moves);
 
+    // Deadline is set before searching, stop() forces the first ply anyway
     if (args.p_ponderhit_finish_time) {
         *args.p_ponderhit_finish_time = finish_time;
-        args.eng->get_searcher().set_finish_time({});
+        args.eng->get_watchdog().set_deadline({});
     } else {
-        args.eng->get_searcher().set_finish_time(finish_time);
+        args.eng->get_watchdog().set_deadline(finish_time);
     }
 
     move::FatMove best;
@@ -525,6 +661,8 @@ void Go::search_impl(SearchArgs args) {
     args.eng->log(msg, LogLevel::RAW_MESSAGE, true);
     args.eng->get_result_lock().unlock();
 
+    // Including one set by a ponderhit after the search finished
+    args.eng->get_watchdog().set_deadline({});
     args.eng->set_busy(false);
     return;
 };
@@ -536,6 +674,7 @@ bool Stop::sufficient_args() const { return m_engine->is_busy(); };
 std::optional<int> Stop::execute() {
     m_engine->get_result_lock().unlock();
     m_engine->get_searcher().stop();
+    m_engine->get_perft().stop();
     return {};
 };
 
@@ -543,7 +682,8 @@ std::optional<int> Stop::execute() {
 
 std::optional<int> Ponderhit::execute() {
     m_engine->get_result_lock().unlock();
-    m_engine->get_searcher().set_finish_time(ponderhit_finish_time);
+    m_engine->get_searcher().get_time_manager().ponderhit();
+    m_engine->get_watchdog().set_deadline(ponderhit_finish_time);
     return {};
 };
 
@@ -587,22 +727,30 @@ void UCIEngine::log(const std::string_view &msg, const LogLevel level,
     return GenericEngine::log(msg, level, flush);
 };
 
-void UCIEngine::report(const size_t depth, const eval::centipawn_t eval,
-                       const size_t nodes,
+void UCIEngine::report(const size_t depth, const size_t line,
+                       const eval::centipawn_t eval,
+                       const search::ABNodeType bound, const size_t nodes,
                        const std::chrono::duration<double> time,
                        const MoveBuffer &pv) const {
     constexpr static uint64_t ms_per_s = 1000;
     std::string info_string;
     info_string += "depth ";
     info_string += std::to_string(depth);
+    info_string += " multipv ";
+    info_string += std::to_string(line);
     info_string += " score ";
-    if (eval == eval::max_eval || eval == -eval::max_eval) {
+    if (eval::is_mate(eval)) {
         info_string += "mate ";
-        info_string += std::to_string((int)(eval > 0) * depth / 2);
+        info_string += std::to_string(eval::mate_in(eval));
     } else {
         info_string += "cp ";
         info_string += std::to_string(eval);
     }
+    if (bound == search::ABNodeType::CUT) {
+        info_string += " lowerbound";
+    } else if (bound == search::ABNodeType::ALL) {
+        info_string += " upperbound";
+    }
     info_string += " nodes ";
     info_string += std::to_string(nodes);
     info_string += " time ";
@@ -65,6 +65,44 @@ class Hash : public UCISpinOption {
     static constexpr size_t gb = 1024;
 };
 
+class Threads : public UCISpinOption {
+   public:
+    Threads(GenericEngine *engine)
+        : UCISpinOption(engine, 1, 1, max_threads) {};
+
+    std::optional<int> execute() override;
+
+   private:
+    static constexpr int max_threads = 256;
+};
+
+class MultiPV : public UCISpinOption {
+   public:
+    MultiPV(GenericEngine *engine)
+        : UCISpinOption(engine, 1, 1, max_lines) {};
+
+    std::optional<int> execute() override;
+
+   private:
+    static constexpr int max_lines = 256;
+};
+
+// Plies at which perft splits the tree between threads.
+// Every position at this depth is stored before counting starts: about 100k
+// at three plies in busy middlegames, but millions at four.
+// Stopping takes effect once each thread finishes its current subtree, so
+// may take as long as the largest subtree.
+class PerftSplitDepth : public UCISpinOption {
+   public:
+    PerftSplitDepth(GenericEngine *engine)
+        : UCISpinOption(engine, 3, 1, max_split_depth) {};
+
+    std::optional<int> execute() override;
+
+   private:
+    static constexpr int max_split_depth = 3;
+};
+
 class Ponder : public UCICheckOption {
    public:
     Ponder(GenericEngine *engine) : UCICheckOption(engine, true) {};
@@ -72,6 +110,32 @@ class Ponder : public UCICheckOption {
     std::optional<int> execute() override { return {}; };
 };
 
+// Search margins, in centipawns, for tuning
+
+class ProbCutMargin : public UCISpinOption {
+   public:
+    ProbCutMargin(GenericEngine *engine)
+        : UCISpinOption(engine, search::SearchParams{}.probcut_margin, 0,
+                        max_margin) {};
+
+    std::optional<int> execute() override;
+
+   private:
+    static constexpr int max_margin = 1000;
+};
+
+class SingularMargin : public UCISpinOption {
+   public:
+    SingularMargin(GenericEngine *engine)
+        : UCISpinOption(engine, search::SearchParams{}.singular_margin, 0,
+                        max_margin) {};
+
+    std::optional<int> execute() override;
+
+   private:
+    static constexpr int max_margin = 100;
+};
+
 //============================================================================//
 // Commands
 //============================================================================//
@@ -155,14 +219,24 @@ class UCIEngine : public GenericEngine {
     void log(const std::string_view &msg, const LogLevel level,
              bool flush) const override;
 
-    void report(const size_t depth, const eval::centipawn_t eval,
-                const size_t nodes, const std::chrono::duration<double> time,
+    void report(const size_t depth, const size_t line,
+                const eval::centipawn_t eval, const search::ABNodeType bound,
+                const size_t nodes,
+                const std::chrono::duration<double> time,
                 const MoveBuffer &pv) const override;
 
     using OptionFactory = std::function<std::unique_ptr<UCIOption>()>;
     std::unordered_map<std::string, OptionFactory> m_options = {
         {"Hash", [this]() { return std::make_unique<Hash>(this); }},
-        {"Ponder", [this]() { return std::make_unique<Ponder>(this); }}};
+        {"Threads", [this]() { return std::make_unique<Threads>(this); }},
+        {"MultiPV", [this]() { return std::make_unique<MultiPV>(this); }},
+        {"PerftSplitDepth",
+         [this]() { return std::make_unique<PerftSplitDepth>(this); }},
+        {"Ponder", [this]() { return std::make_unique<Ponder>(this); }},
+        {"ProbCutMargin",
+         [this]() { return std::make_unique<ProbCutMargin>(this); }},
+        {"SingularMargin",
+         [this]() { return std::make_unique<SingularMargin>(this); }}};
 
     // In ponder, eventual finish time is stored here
     // and set in searcher on ponderhit.
@@ -241,6 +315,10 @@ class Go : public EngineCommand {
         size_t depth{};
         search::Bounds bounds{};
         search::TimeControl tc{};
+        std::optional<size_t> nodes{};
+        std::optional<size_t> mate{};
+        MoveBuffer search_moves{};
+        state::PerftOptions perft_opts{};
         std::optional<std::chrono::time_point<std::chrono::steady_clock>>
             *p_ponderhit_finish_time{};
     };
@@ -248,7 +326,11 @@ class Go : public EngineCommand {
     enum class SearchType : uint8_t { ID, AB, PERFT };
 
     size_t m_depth = 0;
+    size_t m_nodes = 0;
+    size_t m_mate = 0;
+    MoveBuffer m_search_moves{};
     SearchType m_type = SearchType::ID;
+    state::PerftOptions m_perft_opts{};
     bool m_trace = false;
     bool m_ponder = false;
     search::Bounds m_bounds{};
@@ -256,6 +338,9 @@ class Go : public EngineCommand {
     void parse_field(const std::string_view keyword, std::stringstream &args,
                      auto &field);
 
+    void search_moves_impl(const std::string_view keyword,
+                           std::stringstream &args);
+
     template <search::VerbosityLevel Verbosity>
     std::optional<int> execute_impl();
 
@@ -263,7 +348,7 @@ class Go : public EngineCommand {
               Go::SearchType SearchType = Go::SearchType::ID>
     static void search_impl(SearchArgs args);
 
-    std::optional<int> perft_impl();
+    static void perft_impl(SearchArgs args);
 
     search::TimeControl m_tc{};
 
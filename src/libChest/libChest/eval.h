@@ -18,6 +18,26 @@ using centipawn_t = int32_t;
 
 constexpr centipawn_t max_eval = std::numeric_limits<centipawn_t>::max() / 4;
 
+// Mate scores count down from max_eval by the ply (from the root) at which the
+// mated side is to move, so that shorter mates score higher.
+// Scores within max_mate_ply of +/-max_eval are mates.
+constexpr size_t max_mate_ply = 1024;
+constexpr centipawn_t mate_threshold = max_eval - max_mate_ply;
+
+constexpr centipawn_t mate_score(const size_t ply) {
+    return max_eval - static_cast<centipawn_t>(ply);
+}
+
+constexpr bool is_mate(const centipawn_t score) {
+    return score >= mate_threshold || score <= -mate_threshold;
+}
+
+// Full moves until mate, negative if the side to move is mated.
+// Assumes is_mate(score).
+constexpr int mate_in(const centipawn_t score) {
+    return score > 0 ? (max_eval - score + 1) / 2 : -((max_eval + score) / 2);
+}
+
 //============================================================================//
 // Static evaluation
 //============================================================================//
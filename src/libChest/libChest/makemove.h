@@ -8,6 +8,12 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
 #include "board.h"
 #include "eval.h"
 #include "incremental.h"
@@ -82,6 +88,7 @@ struct SearchNode {
         m_astate = astate;
         apply_tuple([this](auto &component) { component = {m_astate}; },
                     m_components);
+        m_check_info[m_cur_depth].reset();
     }
 
     // Get state: calling code should manipulate through incremental interface.
@@ -93,12 +100,23 @@ struct SearchNode {
     // * Leaves the player who moved in check,
     // * Was a castle starting/passing through check
     // Move is pushed to the stack.
+    // Legality is decided from the check info before the move is made.
+    // Unchecked moves must be known to be legal (e.g. from a legal generator),
+    // and are assumed legal outside of debug builds.
+    template <bool Checked = true>
     constexpr bool make_move(const move::FatMove fmove) {
         const move::Move mv = fmove.get_move();
 
+        bool was_legal = true;
+        if constexpr (Checked) {
+            was_legal = move::movegen::AllMoveGenerator::is_legal(
+                m_astate, check_info(), fmove);
+        }
+
         // Prepare for next move
         // Early returns still need to push the made move!
         m_cur_depth++;
+        m_check_info[m_cur_depth].reset();
 
         // Populated later
         MadeMove made{.fmove = fmove, .info = irreversible()};
@@ -123,7 +141,10 @@ struct SearchNode {
         if (mv.type() == move::MoveType::CASTLE) {
             set_to_move(!m_astate.get().state.to_move);
             m_made_moves.push_back(made);
-            return castle(mv.from(), to_move);
+            [[maybe_unused]] const bool castle_legal =
+                castle(mv.from(), to_move);
+            assert(castle_legal == was_legal);
+            return was_legal;
         }
 
         // Move the piece which was moved
@@ -148,8 +169,8 @@ struct SearchNode {
             default:
         }
 
-        // Legality check
-        bool was_legal = !is_checked(to_move);
+        // Verify legality
+        assert(was_legal == !is_checked(to_move));
 
         set_to_move(!m_astate.get().state.to_move);
         m_made_moves.push_back(made);
@@ -166,7 +187,23 @@ struct SearchNode {
     }
 
     constexpr bool is_checked() const {
-        return is_checked(m_astate.get().state.to_move);
+        return !check_info().checkers.empty();
+    }
+
+    // Does a pseudo-legal move give check?
+    constexpr bool gives_check(const move::FatMove fmove) const {
+        return move::movegen::AllMoveGenerator::gives_check(
+            m_astate, check_info(), fmove);
+    }
+
+    // Checks and pins at the current depth, found at most once per node.
+    constexpr const move::movegen::CheckInfo &check_info() const {
+        std::optional<move::movegen::CheckInfo> &ret =
+            m_check_info[m_cur_depth];
+        if (!ret.has_value()) {
+            ret = move::movegen::AllMoveGenerator::check_info(m_astate);
+        }
+        return ret.value();
     }
 
     // Unmakes the last move pushed.
@@ -217,10 +254,58 @@ struct SearchNode {
         return;
     }
 
+    // Passes the turn: the en-passant square is cleared and the side to move
+    // toggled. The halfmove clock is reset, so repetitions are not detected
+    // across the null move.
+    // Must not be made in check.
+    constexpr void make_null_move() {
+        assert(!is_checked());
+        m_cur_depth++;
+        m_check_info[m_cur_depth].reset();
+        m_made_moves.push_back({.fmove = {}, .info = irreversible()});
+
+        m_astate.get().state.fullmove_number +=
+            static_cast<uint>(!m_astate.get().state.to_move);
+        m_astate.get().state.halfmove_clock = 0;
+
+        if (m_astate.get().state.ep_square.has_value()) {
+            remove_ep_sq(m_astate.get().state.ep_square.value());
+        }
+        set_to_move(!m_astate.get().state.to_move);
+    }
+
+    // Unmakes the last move pushed, which must have been a null move.
+    constexpr void unmake_null_move() {
+        const MadeMove unmake = m_made_moves.back();
+        assert(unmake.fmove.is_null());
+        m_made_moves.pop_back();
+        m_cur_depth--;
+
+        set_to_move(!m_astate.get().state.to_move);
+        reset(unmake.info);
+        m_astate.get().state.fullmove_number -=
+            (int)(!m_astate.get().state.to_move);
+    }
+
+    // The last move pushed, null at the root (or after a null move).
+    constexpr move::FatMove last_move() const {
+        return m_cur_depth ? m_made_moves[m_cur_depth - 1].fmove
+                           : move::FatMove{};
+    }
+
+    // Was the last move pushed a null move?
+    constexpr bool last_move_null() const {
+        return m_cur_depth && m_made_moves[m_cur_depth - 1].fmove.is_null();
+    }
+
     // Unmakes all moves since last prep_search().
     void unmake_all() {
         while (m_cur_depth) {
-            unmake_move();
+            if (last_move_null()) {
+                unmake_null_move();
+            } else {
+                unmake_move();
+            }
         }
     }
 
@@ -234,33 +319,36 @@ struct SearchNode {
         m_cur_depth = 0;
         m_made_moves.clear();
         m_found_moves.clear();
+        m_check_info[0].reset();
     }
 
     // Find moves at the current depth.
     // Returns a reference to the vector containing the found moves.
-    template <bool InOrder = false>
+    // Moves are pseudo-legal, unless found by the legal generator.
+    template <bool InOrder = false,
+              typename TMoveGenerator = move::movegen::AllMoveGenerator>
     constexpr MoveBuffer &find_moves() {
         m_found_moves[m_cur_depth].clear();
-        move::movegen::AllMoveGenerator::get_all_moves<InOrder>(
+        TMoveGenerator::template get_all_moves<InOrder>(
             m_astate, m_found_moves[m_cur_depth]);
         return m_found_moves[m_cur_depth];
     }
 
     // Find loud moves at the current depth.
     // Returns a reference to the vector containing the found moves.
+    template <typename TMoveGenerator = move::movegen::AllMoveGenerator>
     constexpr MoveBuffer &find_loud_moves() {
         m_found_moves[m_cur_depth].clear();
-        move::movegen::AllMoveGenerator::get_loud_moves(
-            m_astate, m_found_moves[m_cur_depth]);
+        TMoveGenerator::get_loud_moves(m_astate, m_found_moves[m_cur_depth]);
         return m_found_moves[m_cur_depth];
     }
 
     // Find quiet moves at the current depth.
     // Returns a reference to the vector containing the found moves.
+    template <typename TMoveGenerator = move::movegen::AllMoveGenerator>
     constexpr MoveBuffer &find_quiet_moves() {
         m_found_moves[m_cur_depth].clear();
-        move::movegen::AllMoveGenerator::get_quiet_moves(
-            m_astate, m_found_moves[m_cur_depth]);
+        TMoveGenerator::get_quiet_moves(m_astate, m_found_moves[m_cur_depth]);
         return m_found_moves[m_cur_depth];
     }
 
@@ -438,7 +526,8 @@ struct SearchNode {
 
     //-- Castling helpers ----------------------------------------------------//
 
-    // Assumes move is pseudo-legal, returns whether it was legal.
+    // Assumes move is pseudo-legal, returns whether it was legal (only checked
+    // in debug builds, to verify legality found before the move).
     // If legal, moves the king and the bishop and removes castling rights.
     // Resets the halfmove clock.
     // Sufficient for early return.
@@ -453,11 +542,13 @@ struct SearchNode {
         const board::ColouredPiece cp = {to_move, side.value()};
 
         // Check legality
-        for (const board::Bitboard sq :
-             state::CastlingInfo::get_king_mask(cp).singletons()) {
-            if (move::movegen::AllMoveGenerator::is_attacked(
-                    m_astate, sq.single_bitscan_forward(), to_move)) {
-                legal = false;
+        if constexpr (DEBUG()) {
+            for (const board::Bitboard sq :
+                 state::CastlingInfo::get_king_mask(cp).singletons()) {
+                if (move::movegen::AllMoveGenerator::is_attacked(
+                        m_astate, sq.single_bitscan_forward(), to_move)) {
+                    legal = false;
+                }
             }
         }
 
@@ -591,6 +682,10 @@ struct SearchNode {
 
     SVec<MadeMove, MaxDepth> m_made_moves;
     SVec<MoveBuffer, MaxDepth> m_found_moves;
+
+    // Cached lazily, reset when a move is made to the depth
+    mutable std::array<std::optional<move::movegen::CheckInfo>, MaxDepth + 1>
+        m_check_info{};
 };
 static_assert(IncrementallyUpdateable<SearchNode<1, eval::DefaultEval>>);
 
@@ -598,6 +693,102 @@ static_assert(IncrementallyUpdateable<SearchNode<1, eval::DefaultEval>>);
 // Perft
 //============================================================================//
 
+// Leaf counts of subtrees, by hash and depth.
+// Entries are checked against the full hash. Each bucket keeps the deepest
+// subtree seen, and the most recent.
+// May be shared between threads: torn entries fail the check.
+class PerftTable {
+   public:
+    PerftTable() = default;
+    PerftTable(size_t n) { resize(n); };
+
+    std::optional<uint64_t> at_opt(const Zobrist idx,
+                                   const size_t depth) const {
+        for (const Entry &entry : get(idx).entries) {
+            const uint64_t data = entry.data.load(std::memory_order::relaxed);
+            if ((entry.key.load(std::memory_order::relaxed) ^ data) ==
+                    static_cast<uint64_t>(idx) &&
+                data >> depth_offset == depth) {
+                return data & perft_mask;
+            }
+        }
+        return {};
+    }
+
+    void insert(const Zobrist idx, const size_t depth, const uint64_t perft) {
+        assert(depth > 0 && depth <= max_depth && perft <= perft_mask);
+        Bucket &bucket = get(idx);
+        const uint64_t data = perft | static_cast<uint64_t>(depth)
+                                          << depth_offset;
+        Entry &entry =
+            bucket.entries[0].data.load(std::memory_order::relaxed) >>
+                        depth_offset <=
+                    depth
+                ? bucket.entries[0]
+                : bucket.entries[1];
+        entry.data.store(data, std::memory_order::relaxed);
+        entry.key.store(static_cast<uint64_t>(idx) ^ data,
+                        std::memory_order::relaxed);
+    }
+
+    // Resize to hold (at least one bucket, and) at most n entries, clearing
+    // them.
+    void resize(const size_t n) {
+        m_n_buckets = std::max<size_t>(n / bucket_size, 1);
+        m_buckets = std::make_unique<Bucket[]>(m_n_buckets);
+    }
+
+    void resize_mb(const size_t n) {
+        resize(n * kb * kb / sizeof(Bucket) * bucket_size);
+    }
+
+   private:
+    struct Entry {
+        std::atomic<uint64_t> key;  // hash ^ data
+        std::atomic<uint64_t> data;
+    };
+
+    // Deepest, then most recent
+    static constexpr size_t bucket_size = 2;
+
+    struct Bucket {
+        std::array<Entry, bucket_size> entries;
+    };
+
+    // Data layout, from least significant bit:
+    // * 56 bits: perft
+    // * 8 bits: depth (0 if empty)
+    static constexpr size_t depth_offset = 56;
+    static constexpr uint64_t perft_mask = (uint64_t{1} << depth_offset) - 1;
+    static constexpr size_t max_depth = 0xff;
+
+    // Access helper: multiply-shift the upper hash bits onto the table.
+    Bucket &get(const Zobrist idx) {
+        return m_buckets[((static_cast<uint64_t>(idx) >> 32) * m_n_buckets) >>
+                         32];
+    }
+
+    const Bucket &get(const Zobrist idx) const {
+        return m_buckets[((static_cast<uint64_t>(idx) >> 32) * m_n_buckets) >>
+                         32];
+    }
+
+    static constexpr size_t kb = 1024;
+    size_t m_n_buckets = 1;
+    std::unique_ptr<Bucket[]> m_buckets = std::make_unique<Bucket[]>(1);
+};
+
+// Speedups for perft:
+// * bulk: count legal moves at the last ply without making them,
+// * hash: look up subtrees in a PerftTable (needs a Zobrist component),
+// * legal: generate legal moves, rather than checking pseudo-legal moves
+//   after making them.
+struct PerftOptions {
+    bool bulk = false;
+    bool hash = false;
+    bool legal = false;
+};
+
 // Perft implementation is kept seperate.
 template <size_t MaxDepth, typename... TComponents>
 struct PerftNode : public SearchNode<MaxDepth, TComponents...> {
@@ -616,14 +807,36 @@ struct PerftNode : public SearchNode<MaxDepth, TComponents...> {
         }
     };
 
+    template <PerftOptions Opts>
+    using MoveGenerator =
+        std::conditional_t<Opts.legal, move::movegen::LegalMoveGenerator,
+                           move::movegen::AllMoveGenerator>;
+
     // Count the number of leaves at a certain depth, and (non-root) interior
-    // nodes
-    constexpr PerftResult perft() {
+    // nodes. Leaves which are bulk counted, and cached subtrees, are not
+    // counted as nodes.
+    template <PerftOptions Opts = {}>
+    constexpr PerftResult perft(PerftTable *table = nullptr) {
         // Cutoff
         if (this->bottomed_out()) {
             return {.perft = 1, .nodes = 0};
         }
 
+        const size_t depth_remaining = this->depth_remaining();
+        if constexpr (Opts.hash) {
+            static_assert(PerftNode::template has<Zobrist>());
+            assert(table);
+
+            // Bulk counted nodes are never cached, so not looked up
+            const bool bulk_counted = Opts.bulk && depth_remaining == 1;
+            if (!bulk_counted) {
+                if (const std::optional<uint64_t> cached = table->at_opt(
+                        this->template get<Zobrist>(), depth_remaining)) {
+                    return {.perft = cached.value(), .nodes = 0};
+                }
+            }
+        }
+
 #if DEBUG()
         // Info not tracked by hash, not incrementally made/unmade
         size_t fullmove_number = get_astate().state.fullmove_number;
@@ -642,13 +855,30 @@ struct PerftNode : public SearchNode<MaxDepth, TComponents...> {
             assert(hash == Zobrist(this->get_astate()));
         }
 #endif
-        MoveBuffer &moves = this->find_moves();
+        MoveBuffer &moves =
+            this->template find_moves<false, MoveGenerator<Opts>>();
         PerftResult ret = {0, 0};
 
+        // Bulk count (not cached, as cheaper than a lookup)
+        if constexpr (Opts.bulk) {
+            if (depth_remaining == 1) {
+                if constexpr (Opts.legal) {
+                    ret.perft = moves.size();
+                } else {
+                    for (const move::FatMove m : moves) {
+                        ret.perft += static_cast<uint64_t>(
+                            move::movegen::AllMoveGenerator::is_legal(
+                                get_astate(), m));
+                    }
+                }
+                return ret;
+            }
+        }
+
         for (move::FatMove m : moves) {
-            bool was_legal = this->make_move(m);
+            bool was_legal = this->template make_move<!Opts.legal>(m);
             if (was_legal) {
-                PerftResult subtree_result = perft();
+                PerftResult subtree_result = perft<Opts>(table);
                 ret += subtree_result;
                 ret.nodes += 1;
 
@@ -681,6 +911,10 @@ struct PerftNode : public SearchNode<MaxDepth, TComponents...> {
             assert(hash == this->template get<Zobrist>());
         }
 #endif
+        if constexpr (Opts.hash) {
+            table->insert(this->template get<Zobrist>(), depth_remaining,
+                          ret.perft);
+        }
         return ret;
     };
 };
@@ -705,9 +939,15 @@ struct SearchNodeWithHistory : public SearchNode<MaxDepth, TComponents...> {
    public:
     using ParentNode::ParentNode;
 
+    template <bool Checked = true>
     constexpr bool make_move(const move::FatMove fmove) {
         m_history[ply() % HistorySz] = ParentNode::template get<Zobrist>();
-        return ParentNode::make_move(fmove);
+        return ParentNode::template make_move<Checked>(fmove);
+    }
+
+    constexpr void make_null_move() {
+        m_history[ply() % HistorySz] = ParentNode::template get<Zobrist>();
+        ParentNode::make_null_move();
     }
 
     // Number of repetitions in history since the half-move clock was
@@ -1,10 +1,12 @@
 #include "libChest/makemove.h"
 
+#include <algorithm>
 #include <catch2/catch_test_macros.hpp>
 #include <chrono>
 #include <iostream>
 
 #include "libChest/board.h"
+#include "libChest/perft.h"
 #include "libChest/state.h"
 #include "libChest/util.h"
 
@@ -19,8 +21,10 @@ constexpr size_t max_depth_limit = 6;
 #if DEBUG()
 #include "libChest/eval.h"
 using TSearcher = state::PerftNode<max_depth_limit, eval::DefaultEval, Zobrist>;
+using THashSearcher = TSearcher;
 #else
 using TSearcher = state::PerftNode<max_depth_limit>;
+using THashSearcher = state::PerftNode<max_depth_limit, Zobrist>;
 #endif
 
 struct PerftTest {
@@ -197,6 +201,270 @@ TEST_CASE("Perft tests") {
               << "Mn/s" << '\n';
 }
 
+//----------------------------------------------------------------------------//
+// Bulk-counted/hashed perft
+//----------------------------------------------------------------------------//
+
+// Leaves are counted rather than made, so throughput is in leaves, not nodes.
+constexpr size_t bulk_depth_limit = 5;
+constexpr size_t perft_table_mb = 16;
+
+template <state::PerftOptions Opts, typename TNode>
+void do_leaf_perft_test(const PerftTest &perft_case, const size_t depth_limit,
+                        AveragePerft &leaves) {
+    state::AugmentedState astate(state::State(perft_case.fen));
+    state::PerftTable table;
+    table.resize_mb(perft_table_mb);
+
+    for (size_t i = 0; i < perft_case.results.size() && i < depth_limit; i++) {
+        TNode sn(astate, i);
+        const auto start = std::chrono::steady_clock::now();
+        const auto res = sn.template perft<Opts>(&table);
+        const std::chrono::duration<double> taken =
+            std::chrono::steady_clock::now() - start;
+        leaves.nodes += res.perft;
+        leaves.seconds += taken.count();
+        REQUIRE(res.perft == perft_case.results.at(i));
+    }
+}
+
+TEST_CASE("Bulk-counted and hashed perft") {
+    AveragePerft bulk{};
+    AveragePerft hashed{};
+    for (const auto &perft_case : cases) {
+        do_leaf_perft_test<{.bulk = true}, TSearcher>(
+            perft_case, bulk_depth_limit, bulk);
+        do_leaf_perft_test<{.bulk = true, .hash = true}, THashSearcher>(
+            perft_case, bulk_depth_limit, hashed);
+    }
+
+    std::cerr << indent << "BULK LEAF RATE: "
+              << static_cast<double>(bulk.nodes) / bulk.seconds / million
+              << "Mn/s" << '\n'
+              << indent << "BULK/HASHED LEAF RATE: "
+              << static_cast<double>(hashed.nodes) / hashed.seconds / million
+              << "Mn/s" << '\n';
+}
+
+//----------------------------------------------------------------------------//
+// Legal move generation
+//----------------------------------------------------------------------------//
+
+constexpr size_t legal_movegen_depth = 3;
+
+// The legal generator must find exactly the pseudo-legal moves which are legal
+// when made, in the same order.
+// In check, so must the evasion generator, in any order.
+// Returns the number of disagreeing positions.
+size_t count_legal_movegen_errors(TSearcher &sn, const size_t depth) {
+    const state::AugmentedState &astate = sn.get_astate();
+    MoveBuffer made_legal;
+    for (const move::FatMove m : sn.find_moves<true>()) {
+        if (sn.make_move(m)) {
+            made_legal.push_back(m);
+        }
+        sn.unmake_move();
+    }
+
+    MoveBuffer legal;
+    move::movegen::LegalMoveGenerator::get_all_moves<true>(astate, legal);
+    MoveBuffer staged;
+    move::movegen::LegalMoveGenerator::get_loud_moves(astate, staged);
+    move::movegen::LegalMoveGenerator::get_quiet_moves(astate, staged);
+    size_t ret = static_cast<size_t>(
+        !std::ranges::equal(legal, made_legal) ||
+        !std::ranges::equal(staged, made_legal));
+
+    if (sn.is_checked()) {
+        MoveBuffer evasions;
+        move::movegen::EvasionGenerator::get_loud_moves(astate, evasions);
+        move::movegen::EvasionGenerator::get_quiet_moves(astate, evasions);
+        ret += static_cast<size_t>(
+            !std::ranges::is_permutation(evasions, made_legal));
+    }
+
+    if (depth) {
+        for (const move::FatMove m : legal) {
+            sn.make_move<false>(m);
+            ret += count_legal_movegen_errors(sn, depth - 1);
+            sn.unmake_move();
+        }
+    }
+    return ret;
+}
+
+// En passant uncovering a check along the rank, capturing a checker, and
+// failing to evade a discovered check.
+const std::vector<state::fen_t> ep_legality_fens = {
+    "8/8/8/KPp4r/8/8/8/7k w - c6 0 2",
+    "8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1",
+    "8/8/8/8/3Ppk2/8/8/2B1K3 b - d3 0 1",
+};
+
+TEST_CASE("Legal move generation") {
+    for (const state::fen_t &fen : ep_legality_fens) {
+        state::AugmentedState astate{state::State(fen)};
+        TSearcher sn(astate, max_depth_limit);
+        REQUIRE(count_legal_movegen_errors(sn, 1) == 0);
+    }
+
+    AveragePerft legal{};
+    AveragePerft bulk{};
+    for (const auto &perft_case : cases) {
+        state::AugmentedState astate(state::State(perft_case.fen));
+        TSearcher sn(astate, max_depth_limit);
+        REQUIRE(count_legal_movegen_errors(sn, legal_movegen_depth) == 0);
+
+        do_leaf_perft_test<{.legal = true}, TSearcher>(
+            perft_case, bulk_depth_limit, legal);
+        do_leaf_perft_test<{.bulk = true, .legal = true}, TSearcher>(
+            perft_case, bulk_depth_limit, bulk);
+    }
+
+    std::cerr << indent << "LEGAL LEAF RATE: "
+              << static_cast<double>(legal.nodes) / legal.seconds / million
+              << "Mn/s" << '\n'
+              << indent << "BULK/LEGAL LEAF RATE: "
+              << static_cast<double>(bulk.nodes) / bulk.seconds / million
+              << "Mn/s" << '\n';
+}
+
+//----------------------------------------------------------------------------//
+// Check info
+//----------------------------------------------------------------------------//
+
+constexpr size_t check_info_depth = 3;
+
+// Checks found from the (cached) check info must agree with the position
+// after making the move, including across null moves.
+// Returns the number of disagreements.
+size_t count_gives_check_errors(TSearcher &sn, const size_t depth) {
+    size_t ret = 0;
+    for (const move::FatMove m : sn.find_moves()) {
+        const bool gives_check = sn.gives_check(m);
+        if (sn.make_move(m)) {
+            ret += static_cast<size_t>(gives_check != sn.is_checked());
+            if (depth) {
+                ret += count_gives_check_errors(sn, depth - 1);
+            }
+        }
+        sn.unmake_move();
+    }
+
+    if (depth && !sn.is_checked()) {
+        sn.make_null_move();
+        ret += count_gives_check_errors(sn, 0);
+        sn.unmake_null_move();
+    }
+    return ret;
+}
+
+TEST_CASE("Check info") {
+    for (const auto &perft_case : cases) {
+        state::AugmentedState astate(state::State(perft_case.fen));
+        TSearcher sn(astate, max_depth_limit);
+        REQUIRE(count_gives_check_errors(sn, check_info_depth) == 0);
+    }
+    for (const state::fen_t &fen : ep_legality_fens) {
+        state::AugmentedState astate{state::State(fen)};
+        TSearcher sn(astate, max_depth_limit);
+        REQUIRE(count_gives_check_errors(sn, 1) == 0);
+    }
+}
+
+//----------------------------------------------------------------------------//
+// Parallel perft
+//----------------------------------------------------------------------------//
+
+constexpr size_t parallel_perft_depth = 3;
+constexpr size_t parallel_perft_threads = 3;
+
+// Divide must match a serial perft move for move, whatever the split.
+TEST_CASE("Parallel perft divide matches serial") {
+    for (const auto &perft_case : cases) {
+        state::AugmentedState astate(state::State(perft_case.fen));
+        state::ParallelPerft<max_depth_limit> perft;
+        perft.set_threads(parallel_perft_threads);
+
+        std::vector<std::pair<move::FatMove, uint64_t>> serial;
+        TSearcher sn(astate, parallel_perft_depth);
+        for (const move::FatMove m : sn.find_moves()) {
+            if (sn.make_move(m)) {
+                serial.emplace_back(m, sn.perft().perft);
+            }
+            sn.unmake_move();
+        }
+
+        for (size_t split = 1; split <= parallel_perft_depth + 1; split++) {
+            perft.set_split_depth(split);
+            const auto divide = perft.divide(astate, parallel_perft_depth);
+            REQUIRE(divide.has_value());
+            REQUIRE(divide->size() == serial.size());
+            for (size_t i = 0; i < serial.size(); i++) {
+                REQUIRE(divide->at(i).fmove == serial[i].first);
+                REQUIRE(divide->at(i).perft == serial[i].second);
+            }
+        }
+
+        // Threads share the table
+        perft.set_split_depth(1);
+        const auto divide = perft.divide<{.bulk = true, .hash = true}>(
+            astate, parallel_perft_depth);
+        REQUIRE(divide.has_value());
+        REQUIRE(divide->size() == serial.size());
+        for (size_t i = 0; i < serial.size(); i++) {
+            REQUIRE(divide->at(i).perft == serial[i].second);
+        }
+    }
+}
+
+//============================================================================//
+// Pseudo-legality checks
+//============================================================================//
+
+constexpr size_t pseudo_legal_depth = 3;
+
+// Moves from other positions (the last two plies) are pseudo-legal iff they
+// are generated in this position.
+// Returns the number of disagreements.
+size_t count_pseudo_legal_errors(TSearcher &sn, const MoveBuffer &parent_moves,
+                                 const MoveBuffer &grandparent_moves,
+                                 const size_t depth) {
+    const MoveBuffer moves = sn.find_moves();
+    size_t ret = 0;
+
+    for (const MoveBuffer *other :
+         {&moves, &parent_moves, &grandparent_moves}) {
+        for (const move::FatMove m : *other) {
+            const bool generated =
+                std::find(moves.begin(), moves.end(), m) != moves.end();
+            ret += static_cast<size_t>(
+                move::movegen::AllMoveGenerator::is_pseudo_legal(
+                    sn.get_astate(), m) != generated);
+        }
+    }
+
+    if (depth) {
+        for (const move::FatMove m : moves) {
+            if (sn.make_move(m)) {
+                ret += count_pseudo_legal_errors(sn, moves, parent_moves,
+                                                 depth - 1);
+            }
+            sn.unmake_move();
+        }
+    }
+    return ret;
+}
+
+TEST_CASE("Pseudo-legality of moves from other positions") {
+    for (const auto &perft_case : cases) {
+        state::AugmentedState astate(state::State(perft_case.fen));
+        TSearcher sn(astate, max_depth_limit);
+        REQUIRE(count_pseudo_legal_errors(sn, {}, {}, pseudo_legal_depth) ==
+                0);
+    }
+}
+
 //============================================================================//
 // Repetition detection
 //============================================================================//
@@ -252,4 +520,26 @@ TEST_CASE("Example PV repetition from game") {
     REQUIRE(sn.n_repetitions() < 3);
 }
 
+TEST_CASE("Null move make/unmake") {
+    state::AugmentedState astate{state::new_game_fen};
+    THistorySearcher sn(astate, max_search_depth);
+    sn.make_move({{board::E2, board::E4, move::MoveType::DOUBLE_PUSH},
+                  board::Piece::PAWN});
+    const Zobrist hash = sn.get<Zobrist>();
+
+    sn.make_null_move();
+    REQUIRE(sn.last_move_null());
+    REQUIRE(astate.state.to_move == board::Colour::WHITE);
+    REQUIRE(!astate.state.ep_square.has_value());
+    REQUIRE(sn.get<Zobrist>() == Zobrist(astate));
+    REQUIRE(!sn.n_repetitions());
+
+    sn.unmake_null_move();
+    REQUIRE(!sn.last_move_null());
+    REQUIRE(astate.state.to_move == board::Colour::BLACK);
+    REQUIRE(astate.state.ep_square.has_value());
+    REQUIRE(astate.state.halfmove_clock == 0);
+    REQUIRE(sn.get<Zobrist>() == hash);
+}
+
 // NOLINTEND(cppcoreguidelines-avoid-do-while)
@@ -298,6 +298,10 @@ struct LongAlgMove : Wrapper<long_alg_t, LongAlgMove> {
             std::optional<board::Piece> promoted = {};
             if (value.size() == promo_movestr_len) {
                 promoted = board::io::from_char(value[promo_movestr_len - 1]);
+                if (promoted == board::Piece::PAWN ||
+                    promoted == board::Piece::KING) {
+                    return {};
+                }
             }
 
             // Pushes
@@ -7,12 +7,17 @@
 // Templated classes provide functions for loud/quiet/all move generation
 // (loud moves are tactical moves, i.e. result in material change).
 //
+// A legal generator filters the pseudo-legal moves by pins and checks found
+// once per call, and may be used in place of the pseudo-legal generator.
+//
 // TODO: rewrite the whole header using CRTP.
 //
 //============================================================================//
 
 #pragma once
 
+#include <array>
+#include <cassert>
 #include <tuple>
 
 #include "attack.h"
@@ -451,6 +456,23 @@ static_assert(StagedMoveGenerator<RookMover>);
 // All move generation
 //============================================================================//
 
+// Checks and pins in a position, from the point of view of the side to move.
+struct CheckInfo {
+    // Enemy pieces checking the side to move.
+    board::Bitboard checkers;
+
+    // Pieces which alone block an enemy slider from each side's king.
+    std::array<board::Bitboard, board::n_colours> pinned;
+
+    // Pieces of the side to move which alone block a friendly slider from
+    // the enemy king: moving off the line gives check.
+    board::Bitboard discoverers;
+
+    // Squares from which each piece of the side to move would check the
+    // enemy king.
+    std::array<board::Bitboard, board::n_pieces> check_squares;
+};
+
 // Gets all the legal moves in a position, performs attack detection.
 class AllMoveGenerator {
    public:
@@ -508,7 +530,438 @@ class AllMoveGenerator {
                 (astate.state.copy_bitboard({!colour, board::Piece::KING})));
     }
 
-   private:
+    // Pieces of both colours attacking a square, given an occupancy.
+    // The occupancy may have pieces removed (e.g. for exchanges), revealing
+    // sliders behind them, but removed pieces are not masked out.
+    constexpr static board::Bitboard attackers_to(
+        const state::AugmentedState &astate, const board::Square sq,
+        const board::Bitboard occupancy) {
+        const state::State &state = astate.state;
+        const auto both = [&state](const board::Piece piece) {
+            return state.copy_bitboard({board::Colour::WHITE, piece}) |
+                   state.copy_bitboard({board::Colour::BLACK, piece});
+        };
+        const board::Bitboard queens = both(board::Piece::QUEEN);
+
+        return (s_pawn_attacker(sq, board::Colour::BLACK) &
+                state.copy_bitboard(
+                    {board::Colour::WHITE, board::Piece::PAWN})) |
+               (s_pawn_attacker(sq, board::Colour::WHITE) &
+                state.copy_bitboard(
+                    {board::Colour::BLACK, board::Piece::PAWN})) |
+               (s_knight_attacker(sq) & both(board::Piece::KNIGHT)) |
+               (s_bishop_attacker(sq, occupancy) &
+                (both(board::Piece::BISHOP) | queens)) |
+               (s_rook_attacker(sq, occupancy) &
+                (both(board::Piece::ROOK) | queens)) |
+               (s_king_attacker(sq) & both(board::Piece::KING));
+    }
+
+    // Could the move have been generated in this position?
+    // Checks moves from other sources (e.g. hash moves) before generation.
+    constexpr static bool is_pseudo_legal(const state::AugmentedState &astate,
+                                          const FatMove fmove) {
+        const Move mv = fmove.get_move();
+        const MoveType type = mv.type();
+        const board::Colour to_move = astate.state.to_move;
+        const board::Bitboard from_bb(mv.from());
+        const board::Bitboard to_bb(mv.to());
+
+        // Castles store the side in place of the piece
+        if (type == MoveType::CASTLE) {
+            const board::Piece side = fmove.get_piece();
+            if (side != board::Piece::KING && side != board::Piece::QUEEN) {
+                return false;
+            }
+            const board::ColouredPiece cp = {to_move, side};
+            return astate.state.castling_rights.get_square_rights(cp) &&
+                   mv.from() == state::CastlingInfo::get_rook_start(cp) &&
+                   mv.to() == state::CastlingInfo::get_king_start(to_move) &&
+                   (state::CastlingInfo::get_rook_mask(cp) &
+                    astate.total_occupancy)
+                       .empty();
+        }
+
+        if ((astate.state.copy_bitboard({to_move, fmove.get_piece()}) &
+             from_bb)
+                .empty()) {
+            return false;
+        }
+
+        // Destination must agree with capture flag
+        if (type == MoveType::CAPTURE_EP) {
+            return fmove.get_piece() == board::Piece::PAWN &&
+                   astate.state.ep_square.has_value() &&
+                   astate.state.ep_square.value() == mv.to() &&
+                   s_pawn_attacker(mv.from(), to_move) & to_bb;
+        }
+        if (is_capture(type) ? (astate.opponent_occupancy() & to_bb).empty()
+                             : !(astate.total_occupancy & to_bb).empty()) {
+            return false;
+        }
+
+        switch (fmove.get_piece()) {
+            case board::Piece::PAWN:
+                return is_pseudo_legal_pawn_move(astate, mv);
+            case board::Piece::KNIGHT:
+                return is_piece_move(type) &&
+                       s_knight_attacker(mv.from()) & to_bb;
+            case board::Piece::BISHOP:
+                return is_piece_move(type) &&
+                       s_bishop_attacker(mv.from(), astate.total_occupancy) &
+                           to_bb;
+            case board::Piece::ROOK:
+                return is_piece_move(type) &&
+                       s_rook_attacker(mv.from(), astate.total_occupancy) &
+                           to_bb;
+            case board::Piece::QUEEN:
+                return is_piece_move(type) &&
+                       (s_bishop_attacker(mv.from(), astate.total_occupancy) |
+                        s_rook_attacker(mv.from(), astate.total_occupancy)) &
+                           to_bb;
+            case board::Piece::KING:
+                return is_piece_move(type) &&
+                       s_king_attacker(mv.from()) & to_bb;
+            default:
+                return false;
+        }
+    }
+
+    // Does a pseudo-legal move leave the mover's king safe?
+    // Agrees with SearchNode::make_move(), without making the move: only the
+    // occupancy and captured piece are updated for attack detection.
+    constexpr static bool is_legal(const state::AugmentedState &astate,
+                                   const FatMove fmove) {
+        const Move mv = fmove.get_move();
+        const MoveType type = mv.type();
+        const board::Colour to_move = astate.state.to_move;
+
+        // King may not start or pass through check
+        if (type == MoveType::CASTLE) {
+            const board::ColouredPiece cp = {
+                to_move, state::CastlingInfo::get_side(mv.from(), to_move)
+                             .value()};
+            for (const board::Bitboard sq :
+                 state::CastlingInfo::get_king_mask(cp).singletons()) {
+                if (is_attacked(astate, sq.single_bitscan_forward(),
+                                to_move)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        const board::Bitboard from_bb(mv.from());
+        const board::Bitboard to_bb(mv.to());
+        board::Bitboard captured{};
+        if (type == MoveType::CAPTURE_EP) {
+            captured = board::Bitboard(board::Square{
+                mv.to().file(), board::ranks::double_push_rank(!to_move)});
+        } else if (is_capture(type)) {
+            captured = to_bb;
+        }
+        const board::Bitboard occupancy =
+            (astate.total_occupancy ^ from_bb ^ captured) | to_bb;
+        const board::Square king_sq =
+            fmove.get_piece() == board::Piece::KING
+                ? mv.to()
+                : astate.state.copy_bitboard({to_move, board::Piece::KING})
+                      .single_bitscan_forward();
+
+        const auto enemy = [&astate, to_move,
+                            captured](const board::Piece piece) {
+            return astate.state.copy_bitboard({!to_move, piece})
+                .setdiff(captured);
+        };
+        const board::Bitboard queens = enemy(board::Piece::QUEEN);
+        return ((s_pawn_attacker(king_sq, to_move) &
+                 enemy(board::Piece::PAWN)) |
+                (s_knight_attacker(king_sq) & enemy(board::Piece::KNIGHT)) |
+                (s_bishop_attacker(king_sq, occupancy) &
+                 (enemy(board::Piece::BISHOP) | queens)) |
+                (s_rook_attacker(king_sq, occupancy) &
+                 (enemy(board::Piece::ROOK) | queens)) |
+                (s_king_attacker(king_sq) & enemy(board::Piece::KING)))
+            .empty();
+    }
+
+    // Does a pseudo-legal move leave the mover's king safe, given the check
+    // info? Pins decide most moves: king moves, en passant, and moves out of
+    // check are checked on the occupancy instead, and castles by attacks on
+    // the king's path.
+    constexpr static bool is_legal(const state::AugmentedState &astate,
+                                   const CheckInfo &info,
+                                   const FatMove fmove) {
+        const Move mv = fmove.get_move();
+        const MoveType type = mv.type();
+        const board::Colour to_move = astate.state.to_move;
+
+        if (type == MoveType::CASTLE) {
+            if (!info.checkers.empty()) {
+                return false;
+            }
+            const board::ColouredPiece cp = {
+                to_move, state::CastlingInfo::get_side(mv.from(), to_move)
+                             .value()};
+            const board::Bitboard path =
+                state::CastlingInfo::get_king_mask(cp).setdiff(
+                    board::Bitboard(
+                        state::CastlingInfo::get_king_start(to_move)));
+            for (const board::Bitboard sq : path.singletons()) {
+                if (is_attacked(astate, sq.single_bitscan_forward(),
+                                to_move)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        if (fmove.get_piece() == board::Piece::KING ||
+            type == MoveType::CAPTURE_EP || !info.checkers.empty()) {
+            return is_legal(astate, fmove);
+        }
+        return (info.pinned[static_cast<size_t>(to_move)] &
+                board::Bitboard(mv.from()))
+                   .empty() ||
+               !(line(king_square(astate, to_move), mv.from()) &
+                 board::Bitboard(mv.to()))
+                    .empty();
+    }
+
+    constexpr static CheckInfo check_info(const state::AugmentedState &astate) {
+        const board::Colour to_move = astate.state.to_move;
+        const board::Bitboard occ = astate.total_occupancy;
+        const board::Square king_sq = king_square(astate, to_move);
+        const board::Square enemy_king_sq = king_square(astate, !to_move);
+
+        CheckInfo ret{
+            .checkers = attackers_to(astate, king_sq, occ) &
+                        astate.opponent_occupancy(),
+            .pinned = {},
+            .discoverers =
+                blockers(astate, enemy_king_sq, to_move) &
+                astate.side_occupancy(),
+            .check_squares = {},
+        };
+        for (const board::Colour colour : board::colours) {
+            ret.pinned[static_cast<size_t>(colour)] =
+                blockers(astate, king_square(astate, colour), !colour) &
+                astate.side_occupancy(colour);
+        }
+
+        const auto check_squares = [&ret](const board::Piece piece) -> auto & {
+            return ret.check_squares[static_cast<size_t>(piece)];
+        };
+        check_squares(board::Piece::PAWN) =
+            s_pawn_attacker(enemy_king_sq, !to_move);
+        check_squares(board::Piece::KNIGHT) = s_knight_attacker(enemy_king_sq);
+        check_squares(board::Piece::BISHOP) =
+            s_bishop_attacker(enemy_king_sq, occ);
+        check_squares(board::Piece::ROOK) = s_rook_attacker(enemy_king_sq, occ);
+        check_squares(board::Piece::QUEEN) =
+            check_squares(board::Piece::BISHOP) |
+            check_squares(board::Piece::ROOK);
+        return ret;
+    }
+
+    // Does a pseudo-legal move give check?
+    // Normal moves are found from the check info, special moves (castles,
+    // en passant, promotions) from the occupancy after the move.
+    constexpr static bool gives_check(const state::AugmentedState &astate,
+                                      const CheckInfo &info,
+                                      const FatMove fmove) {
+        const Move mv = fmove.get_move();
+        const MoveType type = mv.type();
+        if (type == MoveType::CASTLE || type == MoveType::CAPTURE_EP ||
+            is_promotion(type)) {
+            return gives_special_check(astate, fmove);
+        }
+
+        const board::Bitboard from_bb(mv.from());
+        const board::Bitboard to_bb(mv.to());
+
+        // Direct
+        if (!(info.check_squares[static_cast<size_t>(fmove.get_piece())] &
+              to_bb)
+                 .empty()) {
+            return true;
+        }
+
+        // Discovered
+        return !(info.discoverers & from_bb).empty() &&
+               (line(king_square(astate, !astate.state.to_move), mv.from()) &
+                to_bb)
+                   .empty();
+    }
+
+   protected:
+    constexpr static board::Square king_square(
+        const state::AugmentedState &astate, const board::Colour colour) {
+        return astate.state.copy_bitboard({colour, board::Piece::KING})
+            .single_bitscan_forward();
+    }
+
+    // Pieces (of either side) which alone block sliders of a colour from a
+    // square.
+    constexpr static board::Bitboard blockers(
+        const state::AugmentedState &astate, const board::Square sq,
+        const board::Colour slider_colour) {
+        const auto sliders = [&astate,
+                              slider_colour](const board::Piece piece) {
+            return astate.state.copy_bitboard({slider_colour, piece});
+        };
+        const board::Bitboard queens = sliders(board::Piece::QUEEN);
+        const board::Bitboard snipers =
+            (s_bishop_attacker(sq, {}) &
+             (sliders(board::Piece::BISHOP) | queens)) |
+            (s_rook_attacker(sq, {}) & (sliders(board::Piece::ROOK) | queens));
+
+        board::Bitboard ret{};
+        for (const board::Bitboard sniper : snipers.singletons()) {
+            const board::Bitboard blocking =
+                between(sq, sniper.single_bitscan_forward()) &
+                astate.total_occupancy;
+            if (blocking.size() == 1) {
+                ret |= blocking;
+            }
+        }
+        return ret;
+    }
+
+    // Checks by the side to move after a castle, en passant or promotion:
+    // attackers of the enemy king are found on the occupancy after the move.
+    constexpr static bool gives_special_check(
+        const state::AugmentedState &astate, const FatMove fmove) {
+        const Move mv = fmove.get_move();
+        const MoveType type = mv.type();
+        const board::Colour to_move = astate.state.to_move;
+        const auto ours = [&astate, to_move](const board::Piece piece) {
+            return astate.state.copy_bitboard({to_move, piece});
+        };
+
+        board::Bitboard pawns = ours(board::Piece::PAWN);
+        board::Bitboard knights = ours(board::Piece::KNIGHT);
+        board::Bitboard diagonal =
+            ours(board::Piece::BISHOP) | ours(board::Piece::QUEEN);
+        board::Bitboard orthogonal =
+            ours(board::Piece::ROOK) | ours(board::Piece::QUEEN);
+        board::Bitboard occupancy = astate.total_occupancy;
+
+        if (type == MoveType::CASTLE) {
+            const board::ColouredPiece cp = {
+                to_move, state::CastlingInfo::get_side(mv.from(), to_move)
+                             .value()};
+            const board::Bitboard rook_from(
+                state::CastlingInfo::get_rook_start(cp));
+            const board::Bitboard rook_to(
+                state::CastlingInfo::get_rook_destination(cp));
+            occupancy ^=
+                board::Bitboard(state::CastlingInfo::get_king_start(to_move)) |
+                board::Bitboard(
+                    state::CastlingInfo::get_king_destination(cp)) |
+                rook_from | rook_to;
+            orthogonal ^= rook_from | rook_to;
+        } else {
+            const board::Bitboard from_bb(mv.from());
+            const board::Bitboard to_bb(mv.to());
+            occupancy = occupancy.setdiff(from_bb) | to_bb;
+            pawns ^= from_bb;
+            if (type == MoveType::CAPTURE_EP) {
+                occupancy ^= board::Bitboard(board::Square{
+                    mv.to().file(), board::ranks::double_push_rank(!to_move)});
+                pawns |= to_bb;
+            } else {
+                switch (promoted_piece(type)) {
+                    case board::Piece::KNIGHT:
+                        knights |= to_bb;
+                        break;
+                    case board::Piece::BISHOP:
+                        diagonal |= to_bb;
+                        break;
+                    case board::Piece::ROOK:
+                        orthogonal |= to_bb;
+                        break;
+                    default:
+                        diagonal |= to_bb;
+                        orthogonal |= to_bb;
+                }
+            }
+        }
+
+        const board::Square king_sq = king_square(astate, !to_move);
+        return !((s_pawn_attacker(king_sq, !to_move) & pawns) |
+                 (s_knight_attacker(king_sq) & knights) |
+                 (s_bishop_attacker(king_sq, occupancy) & diagonal) |
+                 (s_rook_attacker(king_sq, occupancy) & orthogonal))
+                    .empty();
+    }
+
+    // Move types generated for pieces other than pawns.
+    constexpr static bool is_piece_move(const MoveType type) {
+        return type == MoveType::NORMAL || type == MoveType::CAPTURE;
+    }
+
+    // Assumes the pawn exists, and the destination agrees with the move type.
+    constexpr static bool is_pseudo_legal_pawn_move(
+        const state::AugmentedState &astate, const Move mv) {
+        const MoveType type = mv.type();
+        const board::Colour to_move = astate.state.to_move;
+        const board::Bitboard to_bb(mv.to());
+
+        // Promote iff reaching the back rank
+        if (is_promotion(type) !=
+            !(board::Bitboard::rank_mask(board::ranks::back_rank(to_move)) &
+              to_bb)
+                 .empty()) {
+            return false;
+        }
+
+        if (is_capture(type)) {
+            return !(s_pawn_attacker(mv.from(), to_move) & to_bb).empty();
+        }
+        if (type == MoveType::SINGLE_PUSH || is_promotion(type)) {
+            return s_pawn_single_pusher(mv.from(), to_move) == to_bb;
+        }
+        if (type == MoveType::DOUBLE_PUSH) {
+            return s_pawn_double_pusher(mv.from(), to_move) == to_bb &&
+                   (s_pawn_single_pusher(mv.from(), to_move) &
+                    astate.total_occupancy)
+                       .empty();
+        }
+        return false;
+    }
+
+    // Squares strictly between two squares on a line, otherwise empty.
+    constexpr static board::Bitboard between(const board::Square a,
+                                             const board::Square b) {
+        const board::Bitboard a_bb(a);
+        const board::Bitboard b_bb(b);
+        if (!(s_rook_attacker(a, b_bb) & b_bb).empty()) {
+            return s_rook_attacker(a, b_bb) & s_rook_attacker(b, a_bb);
+        }
+        if (!(s_bishop_attacker(a, b_bb) & b_bb).empty()) {
+            return s_bishop_attacker(a, b_bb) & s_bishop_attacker(b, a_bb);
+        }
+        return {};
+    }
+
+    // The whole line through two squares, otherwise empty.
+    constexpr static board::Bitboard line(const board::Square a,
+                                          const board::Square b) {
+        const board::Bitboard a_bb(a);
+        const board::Bitboard b_bb(b);
+        const board::Bitboard none{};
+        if (!(s_rook_attacker(a, none) & b_bb).empty()) {
+            return (s_rook_attacker(a, none) & s_rook_attacker(b, none)) |
+                   a_bb | b_bb;
+        }
+        if (!(s_bishop_attacker(a, none) & b_bb).empty()) {
+            return (s_bishop_attacker(a, none) & s_bishop_attacker(b, none)) |
+                   a_bb | b_bb;
+        }
+        return {};
+    }
+
     // Hold instances of Attackers
     inline static const attack::PawnAttacker s_pawn_attacker;
     inline static const attack::PawnSinglePusher s_pawn_single_pusher;
@@ -537,4 +990,436 @@ static_assert(StagedMoveGenerator<AllMoveGenerator>);
 static_assert(OneshotMoveGenerator<AllMoveGenerator>);
 static_assert(AttackDetector<AllMoveGenerator>);
 
+//============================================================================//
+// Legal move generation
+//============================================================================//
+
+// Checks and pins against the king of the side to move.
+struct KingSafety {
+    board::Square king_sq;
+    board::Bitboard checkers;
+
+    // Non-king moves must land here: anywhere if unchecked, on the checker or
+    // between it and the king if in single check, and nowhere in double check.
+    board::Bitboard check_mask;
+
+    // Squares attacked by the opponent, seen through the king, so that it
+    // can't step back along a checking ray.
+    board::Bitboard danger;
+
+    // A pinned piece may only move along the ray from the king to its pinner
+    // (inclusive), of which there is at most one in each direction.
+    board::Bitboard pinned;
+    std::array<board::Bitboard, 8> pin_rays;
+    size_t n_pins;
+};
+
+// Gets only legal moves: pseudo-legal moves are filtered with the king's
+// safety, computed once per call, rather than by making them.
+// En passant, which may uncover a check along the rank of both pawns, is
+// checked on the occupancy instead.
+// Attack detection and pseudo-legality checks are shared with the
+// pseudo-legal generator.
+class LegalMoveGenerator : public AllMoveGenerator {
+   public:
+    constexpr LegalMoveGenerator() = delete;
+
+    constexpr static void get_quiet_moves(const state::AugmentedState &astate,
+                                          MoveBuffer &moves) {
+        const KingSafety safety = king_safety(astate);
+        const size_t start = moves.size();
+        for_each_mover(safety, [&](auto &mover) {
+            mover.get_quiet_moves(astate, moves);
+        });
+        retain_legal(astate, safety, moves, start);
+    };
+
+    constexpr static void get_loud_moves(const state::AugmentedState &astate,
+                                         MoveBuffer &moves) {
+        const KingSafety safety = king_safety(astate);
+        const size_t start = moves.size();
+        for_each_mover(safety, [&](auto &mover) {
+            mover.get_loud_moves(astate, moves);
+        });
+        retain_legal(astate, safety, moves, start);
+    };
+
+    // Gets all moves, either in order (loud, then quiet, slower),
+    // or with no guarantees about ordering (faster).
+    template <bool InOrder = false>
+    constexpr static void get_all_moves(const state::AugmentedState &astate,
+                                        MoveBuffer &moves) {
+        const KingSafety safety = king_safety(astate);
+        const size_t start = moves.size();
+        if constexpr (InOrder) {
+            for_each_mover(safety, [&](auto &mover) {
+                mover.get_loud_moves(astate, moves);
+            });
+            for_each_mover(safety, [&](auto &mover) {
+                mover.get_quiet_moves(astate, moves);
+            });
+        } else {
+            for_each_mover(safety, [&](auto &mover) {
+                mover.get_all_moves(astate, moves);
+            });
+        }
+        retain_legal(astate, safety, moves, start);
+    };
+
+    constexpr static KingSafety king_safety(
+        const state::AugmentedState &astate) {
+        const board::Colour to_move = astate.state.to_move;
+        const auto enemy = [&astate, to_move](const board::Piece piece) {
+            return astate.state.copy_bitboard({!to_move, piece});
+        };
+        const board::Bitboard king_bb =
+            astate.state.copy_bitboard({to_move, board::Piece::KING});
+        const board::Square king_sq = king_bb.single_bitscan_forward();
+        const board::Bitboard diagonal =
+            enemy(board::Piece::BISHOP) | enemy(board::Piece::QUEEN);
+        const board::Bitboard orthogonal =
+            enemy(board::Piece::ROOK) | enemy(board::Piece::QUEEN);
+
+        KingSafety ret{.king_sq = king_sq,
+                       .checkers = attackers_to(astate, king_sq,
+                                                astate.total_occupancy) &
+                                   astate.opponent_occupancy(),
+                       .check_mask = ~board::Bitboard{},
+                       .danger = {},
+                       .pinned = {},
+                       .pin_rays = {},
+                       .n_pins = 0};
+
+        // Checks
+        if (ret.checkers.size() > 1) {
+            ret.check_mask = {};
+        } else if (!ret.checkers.empty()) {
+            ret.check_mask =
+                ret.checkers |
+                between(king_sq, ret.checkers.single_bitscan_forward());
+        }
+
+        // Pins: sliders seeing the king through exactly one friendly piece
+        const board::Bitboard snipers =
+            (s_bishop_attacker(king_sq, astate.opponent_occupancy()) &
+             diagonal) |
+            (s_rook_attacker(king_sq, astate.opponent_occupancy()) &
+             orthogonal);
+        for (const board::Bitboard sniper : snipers.singletons()) {
+            const board::Bitboard ray =
+                between(king_sq, sniper.single_bitscan_forward());
+            const board::Bitboard blockers = ray & astate.total_occupancy;
+            if (blockers.size() == 1 &&
+                !(blockers & astate.side_occupancy()).empty()) {
+                ret.pinned |= blockers;
+                ret.pin_rays[ret.n_pins++] = ray | sniper;
+            }
+        }
+
+        // Danger
+        const board::Bitboard occupancy =
+            astate.total_occupancy.setdiff(king_bb);
+        for (const board::Bitboard b :
+             enemy(board::Piece::PAWN).singletons()) {
+            ret.danger |=
+                s_pawn_attacker(b.single_bitscan_forward(), !to_move);
+        }
+        for (const board::Bitboard b :
+             enemy(board::Piece::KNIGHT).singletons()) {
+            ret.danger |= s_knight_attacker(b.single_bitscan_forward());
+        }
+        for (const board::Bitboard b : diagonal.singletons()) {
+            ret.danger |=
+                s_bishop_attacker(b.single_bitscan_forward(), occupancy);
+        }
+        for (const board::Bitboard b : orthogonal.singletons()) {
+            ret.danger |=
+                s_rook_attacker(b.single_bitscan_forward(), occupancy);
+        }
+        ret.danger |= s_king_attacker(
+            enemy(board::Piece::KING).single_bitscan_forward());
+
+        return ret;
+    }
+
+    // Does a pseudo-legal move leave the mover's king safe, given the king's
+    // safety in this position?
+    using AllMoveGenerator::is_legal;
+    constexpr static bool is_legal(const state::AugmentedState &astate,
+                                   const KingSafety &safety,
+                                   const FatMove fmove) {
+        const Move mv = fmove.get_move();
+        const MoveType type = mv.type();
+        const board::Bitboard from_bb(mv.from());
+        const board::Bitboard to_bb(mv.to());
+
+        // King may not start or pass through check
+        if (type == MoveType::CASTLE) {
+            const board::Colour to_move = astate.state.to_move;
+            const board::ColouredPiece cp = {
+                to_move, state::CastlingInfo::get_side(mv.from(), to_move)
+                             .value()};
+            return (state::CastlingInfo::get_king_mask(cp) & safety.danger)
+                .empty();
+        }
+        if (fmove.get_piece() == board::Piece::KING) {
+            return (to_bb & safety.danger).empty();
+        }
+        if (type == MoveType::CAPTURE_EP) {
+            return AllMoveGenerator::is_legal(astate, fmove);
+        }
+
+        if ((to_bb & safety.check_mask).empty()) {
+            return false;
+        }
+        if (!(from_bb & safety.pinned).empty()) {
+            for (size_t i = 0; i < safety.n_pins; i++) {
+                if (!(safety.pin_rays[i] & from_bb).empty()) {
+                    return !(safety.pin_rays[i] & to_bb).empty();
+                }
+            }
+        }
+        return true;
+    }
+
+   private:
+    // Only the king may move out of double check.
+    template <typename F>
+    constexpr static void for_each_mover(const KingSafety &safety,
+                                         F &&generate) {
+        if (safety.checkers.size() > 1) {
+            generate(std::get<KingMover>(s_movers));
+        } else {
+            apply_tuple(generate, s_movers);
+        }
+    }
+
+    // Removes illegal moves after start, keeping the order of the rest.
+    constexpr static void retain_legal(const state::AugmentedState &astate,
+                                       const KingSafety &safety,
+                                       MoveBuffer &moves, const size_t start) {
+        size_t n_legal = start;
+        for (size_t i = start; i < moves.size(); i++) {
+            if (is_legal(astate, safety, moves[i])) {
+                moves[n_legal++] = moves[i];
+            }
+        }
+        moves.resize(n_legal);
+    }
+};
+
+static_assert(StagedMoveGenerator<LegalMoveGenerator>);
+static_assert(OneshotMoveGenerator<LegalMoveGenerator>);
+static_assert(AttackDetector<LegalMoveGenerator>);
+
+//============================================================================//
+// Check evasions
+//============================================================================//
+
+// Gets only legal moves out of check, aiming at the checker and the squares
+// between it and the king, rather than filtering all moves:
+// * king moves to unattacked squares,
+// * captures of a single checker (loud), or interpositions (quiet).
+// Pinned pieces can never evade a check.
+// The side to move must be in check.
+class EvasionGenerator : public LegalMoveGenerator {
+   public:
+    constexpr EvasionGenerator() = delete;
+
+    constexpr static void get_quiet_moves(const state::AugmentedState &astate,
+                                          MoveBuffer &moves) {
+        get_quiet_evasions(astate, king_safety(astate), moves);
+    };
+
+    constexpr static void get_loud_moves(const state::AugmentedState &astate,
+                                         MoveBuffer &moves) {
+        get_loud_evasions(astate, king_safety(astate), moves);
+    };
+
+    // Gets all moves, loud moves always first.
+    template <bool InOrder = false>
+    constexpr static void get_all_moves(const state::AugmentedState &astate,
+                                        MoveBuffer &moves) {
+        const KingSafety safety = king_safety(astate);
+        get_loud_evasions(astate, safety, moves);
+        get_quiet_evasions(astate, safety, moves);
+    };
+
+   private:
+    constexpr static void get_loud_evasions(
+        const state::AugmentedState &astate, const KingSafety &safety,
+        MoveBuffer &moves) {
+        assert(!safety.checkers.empty());
+        get_king_evasions(safety, moves, astate.opponent_occupancy(),
+                          MoveType::CAPTURE);
+        if (safety.checkers.size() > 1) {
+            return;
+        }
+        get_pawn_captures(astate, safety, moves);
+        get_piece_evasions(astate, safety, moves, safety.checkers,
+                           MoveType::CAPTURE);
+    }
+
+    constexpr static void get_quiet_evasions(
+        const state::AugmentedState &astate, const KingSafety &safety,
+        MoveBuffer &moves) {
+        assert(!safety.checkers.empty());
+        get_king_evasions(safety, moves, ~astate.total_occupancy,
+                          MoveType::NORMAL);
+        const board::Bitboard blocks =
+            safety.check_mask.setdiff(safety.checkers);
+        if (blocks.empty()) {
+            return;
+        }
+        get_pawn_blocks(astate, safety, moves, blocks);
+        get_piece_evasions(astate, safety, moves, blocks, MoveType::NORMAL);
+    }
+
+    constexpr static void get_king_evasions(const KingSafety &safety,
+                                            MoveBuffer &moves,
+                                            const board::Bitboard targets,
+                                            const MoveType type) {
+        const board::Bitboard dests =
+            (s_king_attacker(safety.king_sq) & targets).setdiff(safety.danger);
+        for (const board::Bitboard dest : dests.singletons()) {
+            moves.push_back(
+                {Move(safety.king_sq, dest.single_bitscan_forward(), type),
+                 board::Piece::KING});
+        }
+    }
+
+    // Knight, bishop, rook and queen moves to the targets.
+    constexpr static void get_piece_evasions(
+        const state::AugmentedState &astate, const KingSafety &safety,
+        MoveBuffer &moves, const board::Bitboard targets,
+        const MoveType type) {
+        for (const board::Piece piece :
+             {board::Piece::KNIGHT, board::Piece::BISHOP, board::Piece::ROOK,
+              board::Piece::QUEEN}) {
+            const board::Bitboard pieces =
+                astate.state.copy_bitboard({astate.state.to_move, piece})
+                    .setdiff(safety.pinned);
+            for (const board::Bitboard b : pieces.singletons()) {
+                const board::Square from = b.single_bitscan_forward();
+                const board::Bitboard dests =
+                    piece_attacks(piece, from, astate.total_occupancy) &
+                    targets;
+                for (const board::Bitboard dest : dests.singletons()) {
+                    moves.push_back(
+                        {Move(from, dest.single_bitscan_forward(), type),
+                         piece});
+                }
+            }
+        }
+    }
+
+    // Captures of the checker, and en passant (checked on the occupancy),
+    // which may take the checker or block on the ep square.
+    constexpr static void get_pawn_captures(
+        const state::AugmentedState &astate, const KingSafety &safety,
+        MoveBuffer &moves) {
+        const board::Colour to_move = astate.state.to_move;
+        const board::Bitboard pawns =
+            astate.state.copy_bitboard({to_move, board::Piece::PAWN})
+                .setdiff(safety.pinned);
+        const board::Square checker_sq =
+            safety.checkers.single_bitscan_forward();
+        for (const board::Bitboard b :
+             (s_pawn_attacker(checker_sq, !to_move) & pawns).singletons()) {
+            push_pawn_moves(moves, b.single_bitscan_forward(), checker_sq,
+                            to_move, true);
+        }
+
+        if (!astate.state.ep_square.has_value()) {
+            return;
+        }
+        const board::Square ep_sq = astate.state.ep_square.value();
+        for (const board::Bitboard b :
+             (s_pawn_attacker(ep_sq, !to_move) & pawns).singletons()) {
+            const FatMove fmove = {
+                Move(b.single_bitscan_forward(), ep_sq, MoveType::CAPTURE_EP),
+                board::Piece::PAWN};
+            if (AllMoveGenerator::is_legal(astate, fmove)) {
+                moves.push_back(fmove);
+            }
+        }
+    }
+
+    // Single and double pushes onto the check ray.
+    constexpr static void get_pawn_blocks(const state::AugmentedState &astate,
+                                          const KingSafety &safety,
+                                          MoveBuffer &moves,
+                                          const board::Bitboard blocks) {
+        const board::Colour to_move = astate.state.to_move;
+        const board::Bitboard pawns =
+            astate.state.copy_bitboard({to_move, board::Piece::PAWN})
+                .setdiff(safety.pinned);
+        for (const board::Bitboard b : pawns.singletons()) {
+            const board::Square from = b.single_bitscan_forward();
+            const board::Bitboard single = s_pawn_single_pusher(from, to_move);
+            if (!(single & astate.total_occupancy).empty()) {
+                continue;
+            }
+            if (!(single & blocks).empty()) {
+                push_pawn_moves(moves, from, single.single_bitscan_forward(),
+                                to_move, false);
+            }
+            const board::Bitboard dbl = s_pawn_double_pusher(from, to_move);
+            if (!(dbl & blocks).empty() &&
+                (dbl & astate.total_occupancy).empty()) {
+                moves.push_back({Move(from, dbl.single_bitscan_forward(),
+                                      MoveType::DOUBLE_PUSH),
+                                 board::Piece::PAWN});
+            }
+        }
+    }
+
+    // Adds a pawn push or capture, as promotions on the back rank.
+    constexpr static void push_pawn_moves(MoveBuffer &moves,
+                                          const board::Square from,
+                                          const board::Square to,
+                                          const board::Colour to_move,
+                                          const bool capture) {
+        if (to.rank() != board::ranks::back_rank(to_move)) {
+            moves.push_back(
+                {Move(from, to,
+                      capture ? MoveType::CAPTURE : MoveType::SINGLE_PUSH),
+                 board::Piece::PAWN});
+            return;
+        }
+        for (const MoveType type :
+             capture ? std::array{MoveType::PROMOTE_CAPTURE_QUEEN,
+                                  MoveType::PROMOTE_CAPTURE_ROOK,
+                                  MoveType::PROMOTE_CAPTURE_BISHOP,
+                                  MoveType::PROMOTE_CAPTURE_KNIGHT}
+                     : std::array{MoveType::PROMOTE_QUEEN,
+                                  MoveType::PROMOTE_ROOK,
+                                  MoveType::PROMOTE_BISHOP,
+                                  MoveType::PROMOTE_KNIGHT}) {
+            moves.push_back({Move(from, to, type), board::Piece::PAWN});
+        }
+    }
+
+    constexpr static board::Bitboard piece_attacks(
+        const board::Piece piece, const board::Square from,
+        const board::Bitboard occupancy) {
+        switch (piece) {
+            case board::Piece::KNIGHT:
+                return s_knight_attacker(from);
+            case board::Piece::BISHOP:
+                return s_bishop_attacker(from, occupancy);
+            case board::Piece::ROOK:
+                return s_rook_attacker(from, occupancy);
+            case board::Piece::QUEEN:
+                return s_bishop_attacker(from, occupancy) |
+                       s_rook_attacker(from, occupancy);
+            default:
+                return {};
+        }
+    }
+};
+
+static_assert(StagedMoveGenerator<EvasionGenerator>);
+static_assert(OneshotMoveGenerator<EvasionGenerator>);
+
 }  // namespace move::movegen
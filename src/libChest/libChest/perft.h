@@ -0,0 +1,239 @@
+//============================================================================//
+// Parallel perft.
+// Splits the tree at a fixed depth, counting the subtrees on a pool of
+// threads, each with its own PerftNode.
+//============================================================================//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "makemove.h"
+#include "move.h"
+#include "state.h"
+#include "zobrist.h"
+
+namespace state {
+
+// Each thread owns a deque of subtrees: it takes work from the front of its
+// own, then steals from the back of the others' once it runs dry.
+// Subtrees of a root move are dealt to the same thread, so stealing is rare
+// until the end.
+// Hashed perft shares one table between threads.
+// Every subtree is listed before counting starts, so memory grows with the
+// branching factor to the power of the split depth.
+template <size_t MaxDepth, typename... TComponents>
+class ParallelPerft {
+   public:
+    using Node = PerftNode<MaxDepth, TComponents...>;
+
+    // Hashed perft needs incremental hashes
+    using HashNode =
+        std::conditional_t<Node::template has<Zobrist>(), Node,
+                           PerftNode<MaxDepth, TComponents..., Zobrist>>;
+
+    // Leaf count below a legal root move.
+    struct Divide {
+        move::FatMove fmove;
+        uint64_t perft;
+    };
+
+    ParallelPerft() = default;
+    ParallelPerft(const ParallelPerft &) = delete;
+    ParallelPerft(ParallelPerft &&) = delete;
+    ParallelPerft &operator=(const ParallelPerft &) = delete;
+    ParallelPerft &operator=(ParallelPerft &&) = delete;
+    ~ParallelPerft() = default;
+
+    // Sets the number of threads, including the calling thread.
+    // Must not be called during perft.
+    void set_threads(const size_t n_threads) {
+        assert(n_threads > 0);
+        m_threads = n_threads;
+    }
+
+    size_t get_threads() const { return m_threads; }
+
+    // Plies from the root at which the tree is split (at least one).
+    // Must not be called during perft.
+    void set_split_depth(const size_t split_depth) {
+        assert(split_depth > 0 && split_depth <= MaxDepth);
+        m_split_depth = split_depth;
+    }
+
+    size_t get_split_depth() const { return m_split_depth; }
+
+    // Size of the table for hashed perft, allocated when first used, and
+    // kept between runs.
+    void set_hash_mb(const size_t hash_mb) { m_hash_mb = hash_mb; }
+
+    // Stops as soon as each thread finishes its current subtree: subtrees
+    // are not interrupted, so this may take as long as the largest one.
+    void stop() { m_stopped.store(true, std::memory_order::relaxed); }
+
+    // Perft of each legal root move, in generation order (as found by a
+    // serial perft), or empty if stopped.
+    template <PerftOptions Opts = {}>
+    std::optional<std::vector<Divide>> divide(const AugmentedState &astate,
+                                              const size_t depth) {
+        assert(depth <= MaxDepth);
+        m_stopped.store(false, std::memory_order::relaxed);
+        if constexpr (Opts.hash) {
+            if (m_table_mb != m_hash_mb) {
+                m_table.resize_mb(m_hash_mb);
+                m_table_mb = m_hash_mb;
+            }
+        }
+
+        // Subtrees are counted to the same depth as the (serial) root
+        const size_t split_depth = std::max<size_t>(
+            std::min(m_split_depth, depth), 1);
+        const size_t subtree_depth = depth > split_depth ? depth - split_depth
+                                                         : 0;
+
+        std::vector<Divide> ret;
+        split(astate, split_depth, ret);
+
+        m_workers.clear();
+        for (size_t i = 0; i < m_threads; i++) {
+            m_workers.push_back(std::make_unique<Worker>());
+            m_workers.back()->counts.resize(ret.size());
+        }
+        for (size_t i = 0; i < m_subtrees.size(); i++) {
+            const size_t owner =
+                m_subtrees[i].root_idx * m_threads / ret.size();
+            m_workers[owner]->queue.push_back(i);
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < m_threads; i++) {
+            threads.emplace_back([this, i, subtree_depth]() {
+                work<Opts>(i, subtree_depth);
+            });
+        }
+        work<Opts>(0, subtree_depth);
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+
+        m_subtrees.clear();
+        if (m_stopped.load(std::memory_order::relaxed)) {
+            m_workers.clear();
+            return {};
+        }
+        for (const std::unique_ptr<Worker> &worker : m_workers) {
+            for (size_t i = 0; i < ret.size(); i++) {
+                ret[i].perft += worker->counts[i];
+            }
+        }
+        m_workers.clear();
+        return ret;
+    }
+
+   private:
+    // Position at the split depth, below the root move at root_idx.
+    struct Subtree {
+        size_t root_idx;
+        AugmentedState astate;
+    };
+
+    struct Worker {
+        std::mutex lock;
+        std::deque<size_t> queue;     // indices into m_subtrees
+        std::vector<uint64_t> counts;  // per root move
+    };
+
+    // Lists legal root moves, and the subtrees below them.
+    void split(const AugmentedState &astate, const size_t split_depth,
+               std::vector<Divide> &root_moves) {
+        AugmentedState root = astate;
+        Node node{root, split_depth};
+        for (const move::FatMove m : node.find_moves()) {
+            if (node.make_move(m)) {
+                root_moves.push_back({.fmove = m, .perft = 0});
+                collect(node, root_moves.size() - 1);
+            }
+            node.unmake_move();
+        }
+    }
+
+    void collect(Node &node, const size_t root_idx) {
+        if (node.bottomed_out()) {
+            m_subtrees.push_back(
+                {.root_idx = root_idx, .astate = node.get_astate()});
+            return;
+        }
+        for (const move::FatMove m : node.find_moves()) {
+            if (node.make_move(m)) {
+                collect(node, root_idx);
+            }
+            node.unmake_move();
+        }
+    }
+
+    // Pops from the front of this thread's queue, else the back of another's.
+    std::optional<size_t> take(const size_t id) {
+        for (size_t i = 0; i < m_threads; i++) {
+            Worker &worker = *m_workers[(id + i) % m_threads];
+            const std::lock_guard<std::mutex> lock(worker.lock);
+            if (worker.queue.empty()) {
+                continue;
+            }
+            size_t ret{};
+            if (i == 0) {
+                ret = worker.queue.front();
+                worker.queue.pop_front();
+            } else {
+                ret = worker.queue.back();
+                worker.queue.pop_back();
+            }
+            return ret;
+        }
+        return {};
+    }
+
+    template <PerftOptions Opts>
+    void work(const size_t id, const size_t subtree_depth) {
+        AugmentedState astate;
+        std::conditional_t<Opts.hash, HashNode, Node> node{astate,
+                                                            subtree_depth};
+        std::vector<uint64_t> &counts = m_workers[id]->counts;
+        while (!m_stopped.load(std::memory_order::relaxed)) {
+            const std::optional<size_t> idx = take(id);
+            if (!idx.has_value()) {
+                return;
+            }
+            const Subtree &subtree = m_subtrees[idx.value()];
+            astate = subtree.astate;
+            node.set_astate(astate);
+            node.prep_search(subtree_depth);
+            counts[subtree.root_idx] +=
+                node.template perft<Opts>(&m_table).perft;
+        }
+    }
+
+    size_t m_threads = 1;
+    size_t m_split_depth = default_split_depth;
+    std::atomic<bool> m_stopped = false;
+
+    std::vector<Subtree> m_subtrees;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    size_t m_hash_mb = default_hash_mb;
+    size_t m_table_mb = 0;
+    PerftTable m_table{};
+
+    static constexpr size_t default_split_depth = 3;
+    static constexpr size_t default_hash_mb = 16;
+};
+
+}  // namespace state
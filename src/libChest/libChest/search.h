@@ -5,14 +5,22 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <functional>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "eval.h"
 #include "makemove.h"
 #include "move.h"
 #include "state.h"
+#include "timemanagement.h"
 #include "util.h"
 #include "wrapper.h"
 #include "zobrist.h"
@@ -89,18 +97,11 @@ concept Searcher = requires(T t) {
     { t.search() } -> std::convertible_to<SearchResult>;
 };
 
-// Searchers which can be made to return early,
-// and auto-return at a point in time
+// Searchers which can be made to return early (from another thread),
+// e.g. by a Watchdog at a deadline.
 template <typename T>
-// TODO: use steady clock?
-concept StoppableSearcher = requires(
-    T t, std::chrono::time_point<std::chrono::steady_clock> finish_time) {
+concept StoppableSearcher = requires(T t) {
     { t.stop() } -> std::same_as<void>;
-    { t.set_finish_time(finish_time) } -> std::same_as<void>;
-    {
-        t.get_finish_time()
-    } -> std::same_as<
-        std::optional<std::chrono::time_point<std::chrono::steady_clock>>>;
     { t.search() } -> std::convertible_to<SearchResult>;
 };
 
@@ -135,8 +136,12 @@ struct StatReporter {
     StatReporter &operator=(StatReporter &&) = delete;
     virtual ~StatReporter() = default;
 
-    virtual void report(const size_t depth, const eval::centipawn_t eval,
-                        const size_t nodes,
+    // Bound is PV for exact scores,
+    // CUT/ALL for lower/upper bounds (i.e. failed high/low).
+    // Lines are numbered from 1 in MultiPV search (otherwise always 1).
+    virtual void report(const size_t depth, const size_t line,
+                        const eval::centipawn_t eval,
+                        const ABNodeType bound, const size_t nodes,
                         const std::chrono::duration<double> time,
                         const MoveBuffer &pv) const = 0;
 
@@ -234,6 +239,12 @@ struct MvvLva {
                 (attacker_val(mv_a) < attacker_val(mv_b)));
     }
 
+    // Integer key for a capture, ordered consistently with the comparator.
+    constexpr int score(const move::FatMove mv) const {
+        return (victim_val(mv) * static_cast<int>(board::n_pieces)) -
+               attacker_val(mv);
+    }
+
    private:
     // 0 if there is no victim (not a tactical move)
     // enum value + 1 if there is a victim
@@ -265,32 +276,521 @@ struct MvvLva {
     std::reference_wrapper<const state::AugmentedState> m_astate;
 };
 
-// Concrete type used currently
-struct DefaultOrdering {
-    DefaultOrdering(const state::AugmentedState &astate,
-                    const move::FatMove hash_move)
-        : m_mvv_lva(astate), m_hash_move_comparator(hash_move) {};
+//----------------------------------------------------------------------------//
+// Static exchange evaluation
+//----------------------------------------------------------------------------//
 
-    constexpr bool operator()(const move::FatMove mv_a,
-                              const move::FatMove mv_b) const {
-        if (m_hash_move_comparator(mv_a, mv_b)) return true;
-        if (m_hash_move_comparator(mv_b, mv_a)) return false;
-        return m_mvv_lva(mv_a, mv_b);
+// Material won by the side to move from a move, if both sides then recapture
+// on its destination with their least valuable attacker, and either side
+// may stop capturing.
+// Sliders behind pieces which have captured (x-rays) join the exchange.
+// Ignores pins, and promotions after the first move.
+class StaticExchange {
+   public:
+    StaticExchange() = delete;
+
+    static constexpr eval::centipawn_t see(const state::AugmentedState &astate,
+                                           const move::FatMove fmove) {
+        const move::Move mv = fmove.get_move();
+        const move::MoveType type = mv.type();
+        if (type == move::MoveType::CASTLE) {
+            return 0;
+        }
+
+        const state::State &state = astate.state;
+        const board::Square to = mv.to();
+        board::Bitboard occupancy =
+            astate.total_occupancy ^ board::Bitboard(mv.from());
+
+        // gain[d]: material won by the side making the dth capture,
+        // if it is not recaptured.
+        std::array<eval::centipawn_t, max_exchanges + 1> gain{};
+        gain[0] = material_gain(astate, fmove);
+        if (type == move::MoveType::CAPTURE_EP) {
+            occupancy ^= board::Bitboard(board::Square(
+                to.file(), board::ranks::double_push_rank(!state.to_move)));
+        }
+
+        // Piece standing on the destination
+        board::Piece target = fmove.get_piece();
+        if (move::is_promotion(type)) {
+            target = move::promoted_piece(type);
+        }
+
+        board::Colour side = !state.to_move;
+        size_t d = 0;
+        while (d < max_exchanges) {
+            const board::Bitboard attackers =
+                move::movegen::AllMoveGenerator::attackers_to(astate, to,
+                                                              occupancy) &
+                occupancy;
+            const std::optional<board::ColouredPiece> attacker =
+                least_valuable_attacker(state, attackers, side);
+            if (!attacker.has_value()) {
+                break;
+            }
+
+            d++;
+            gain[d] = value(target) - gain[d - 1];
+
+            // The side capturing is losing either way, so its choice does
+            // not matter, and the capture (which may not be safe) is ignored.
+            if (std::max(-gain[d - 1], gain[d]) < 0) {
+                d--;
+                break;
+            }
+
+            occupancy ^=
+                (state.copy_bitboard(attacker.value()) & attackers).ls1b();
+            target = attacker->piece;
+            side = !side;
+        }
+
+        // Each side may stop capturing
+        for (; d > 0; d--) {
+            gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+        }
+        return gain[0];
+    }
+
+    // Material won by a move before any recapture:
+    // the piece captured, and the promotion (less the pawn).
+    static constexpr eval::centipawn_t material_gain(
+        const state::AugmentedState &astate, const move::FatMove fmove) {
+        const move::Move mv = fmove.get_move();
+        const move::MoveType type = mv.type();
+        eval::centipawn_t ret = 0;
+        if (type == move::MoveType::CAPTURE_EP) {
+            ret = value(board::Piece::PAWN);
+        } else if (move::is_capture(type)) {
+            ret = value(astate.state
+                            .piece_at(board::Bitboard(mv.to()),
+                                      !astate.state.to_move)
+                            .value()
+                            .piece);
+        }
+        if (move::is_promotion(type)) {
+            ret += value(move::promoted_piece(type)) -
+                   value(board::Piece::PAWN);
+        }
+        return ret;
+    }
+
+   private:
+    // Every piece may capture at most once.
+    static constexpr size_t max_exchanges = 32;
+
+    static constexpr eval::centipawn_t value(const board::Piece piece) {
+        return eval::StdEval::piece_val(piece);
+    }
+
+    // The king may only capture if the square is no longer defended.
+    static constexpr std::optional<board::ColouredPiece>
+    least_valuable_attacker(const state::State &state,
+                            const board::Bitboard attackers,
+                            const board::Colour side) {
+        for (const board::Piece piece : board::PieceTypesIterator()) {
+            if (!(state.copy_bitboard({side, piece}) & attackers).empty()) {
+                if (piece == board::Piece::KING &&
+                    !attackers.setdiff(state.side_occupancy(side)).empty()) {
+                    return {};
+                }
+                return {{.colour = side, .piece = piece}};
+            }
+        }
+        return {};
+    }
+};
+
+//----------------------------------------------------------------------------//
+// Quiet move ordering
+//----------------------------------------------------------------------------//
+
+constexpr size_t max_killers = 2;
+using Killers = std::array<move::FatMove, max_killers>;
+
+// Butterfly history: scores quiet moves by side, from and to square.
+// Updates are scaled ("gravity") so that scores saturate at +/-max_score,
+// and frequently updated moves do not dominate forever.
+class ButterflyHistory {
+   public:
+    static constexpr int max_score = 16384;
+
+    constexpr int score(const board::Colour side,
+                        const move::FatMove mv) const {
+        return at(side, mv);
+    }
+
+    // Bonus should be within +/-max_score.
+    constexpr void update(const board::Colour side, const move::FatMove mv,
+                          const int bonus) {
+        int16_t &entry = at(side, mv);
+        entry = static_cast<int16_t>(
+            entry + bonus - ((entry * std::abs(bonus)) / max_score));
+    }
+
+    // Halves all scores.
+    constexpr void age() {
+        for (auto &from_table : m_table) {
+            for (auto &to_table : from_table) {
+                for (int16_t &entry : to_table) {
+                    entry /= 2;
+                }
+            }
+        }
+    }
+
+   private:
+    constexpr int16_t &at(const board::Colour side, const move::FatMove mv) {
+        return m_table[static_cast<size_t>(side)][mv.get_move().from()]
+                      [mv.get_move().to()];
+    }
+    constexpr const int16_t &at(const board::Colour side,
+                                const move::FatMove mv) const {
+        return m_table[static_cast<size_t>(side)][mv.get_move().from()]
+                      [mv.get_move().to()];
+    }
+
+    std::array<std::array<std::array<int16_t, board::n_squares>,
+                          board::n_squares>,
+               board::n_colours>
+        m_table{};
+};
+
+// Tables kept by each searcher to order quiet moves:
+// * killers: quiet moves which caused a cutoff at the same ply,
+// * butterfly history: raised by cutoffs, lowered for quiet moves tried
+//   before them,
+// * countermoves: the quiet move which last refuted the previous move,
+//   by its piece and destination.
+// Aged between searches rather than cleared.
+template <size_t MaxDepth>
+class OrderingTables {
+   public:
+    constexpr const Killers &killers(const size_t ply) const {
+        return m_killers[ply];
+    }
+
+    constexpr const ButterflyHistory &history() const { return m_history; }
+
+    // Null at the root, or after a null move.
+    constexpr move::FatMove countermove(const board::Colour side,
+                                        const move::FatMove prev) const {
+        return prev.is_null() ? move::FatMove{}
+                              : m_countermoves[static_cast<size_t>(side)]
+                                              [static_cast<size_t>(
+                                                  prev.get_piece())]
+                                              [prev.get_move().to()];
+    }
+
+    // Records a cutoff by a quiet move, with the quiet moves tried before it.
+    template <typename TMoves>
+    constexpr void update(const size_t ply, const size_t depth,
+                          const board::Colour side, const move::FatMove prev,
+                          const move::FatMove best, const TMoves &tried) {
+        Killers &killers = m_killers[ply];
+        if (killers[0] != best) {
+            std::shift_right(killers.begin(), killers.end(), 1);
+            killers[0] = best;
+        }
+
+        const int bonus = history_bonus(depth);
+        m_history.update(side, best, bonus);
+        for (const move::FatMove mv : tried) {
+            m_history.update(side, mv, -bonus);
+        }
+
+        if (!prev.is_null()) {
+            m_countermoves[static_cast<size_t>(side)]
+                          [static_cast<size_t>(prev.get_piece())]
+                          [prev.get_move().to()] = best;
+        }
+    }
+
+    // Halves history scores and clears killers,
+    // since plies in the last search do not correspond to those in the next.
+    constexpr void age() {
+        m_history.age();
+        m_killers = {};
+    }
+
+   private:
+    static constexpr int max_bonus = 1536;
+
+    // Quadratic in depth, since deeper cutoffs save more nodes.
+    static constexpr int history_bonus(const size_t depth) {
+        return static_cast<int>(
+            std::min<size_t>(depth * depth * 16, max_bonus));
+    }
+
+    std::array<Killers, MaxDepth + 1> m_killers{};
+    ButterflyHistory m_history;
+    std::array<std::array<std::array<move::FatMove, board::n_squares>,
+                          board::n_pieces>,
+               board::n_colours>
+        m_countermoves{};
+};
+
+//----------------------------------------------------------------------------//
+// Staged move picking
+//----------------------------------------------------------------------------//
+
+// Yields moves for a node in stages, only generating moves as they are needed,
+// since cut nodes will often not reach later stages:
+// * the hash move, if pseudo-legal (before any generation),
+// * captures, scored once, and selected by MVV-LVA one at a time,
+// * killers, then the countermove, if pseudo-legal quiet moves,
+// * captures losing material (by SEE), deferred from the capture stage,
+// * quiet moves, selected by history one at a time.
+// In quiescence search, stops after captures (none are deferred),
+// unless quiet moves are also wanted (for check evasions and quiet checks).
+// If unsorted, yields loud then quiet moves in generation order.
+// Hash moves, killers and countermoves are only pseudo-legal, even if the
+// generator is legal.
+// In check, only evasions are generated (whatever the generator).
+template <SearchType Type, bool Sorted, typename TNode,
+          typename TMoveGenerator = move::movegen::AllMoveGenerator>
+class MovePicker {
+   public:
+    MovePicker(TNode &node, const move::FatMove hash_move,
+               const Killers &killers = {},
+               const move::FatMove countermove = {},
+               const ButterflyHistory *history = nullptr,
+               const bool quiets = Type == SearchType::NORMAL,
+               const bool in_check = false)
+        : m_node(node),
+          m_killers(killers),
+          m_quiets(quiets),
+          m_in_check(in_check) {
+        if constexpr (Sorted) {
+            m_hash_move = hash_move;
+            m_countermove = countermove;
+            m_history = history;
+        }
+    }
+
+    // Gets the next move, or none when all moves have been yielded.
+    std::optional<move::FatMove> next() {
+        switch (m_stage) {
+            case Stage::HASH_MOVE:
+                m_stage = Stage::GEN_LOUD;
+                if (!m_hash_move.is_null() &&
+                    (m_quiets ||
+                     move::is_capture(m_hash_move.get_move().type())) &&
+                    move::movegen::AllMoveGenerator::is_pseudo_legal(
+                        m_node.get().get_astate(), m_hash_move)) {
+                    m_generated = false;
+                    return m_hash_move;
+                }
+                [[fallthrough]];
+
+            case Stage::GEN_LOUD:
+                m_moves =
+                    m_in_check
+                        ? &m_node.get()
+                               .template find_loud_moves<
+                                   move::movegen::EvasionGenerator>()
+                        : &m_node.get()
+                               .template find_loud_moves<TMoveGenerator>();
+                if constexpr (Sorted) {
+                    const MvvLva mvv_lva(m_node.get().get_astate());
+                    for (size_t i = 0; i < m_moves->size(); i++) {
+                        m_scores[i] = mvv_lva.score((*m_moves)[i]);
+                    }
+                }
+                m_idx = 0;
+                m_stage = Stage::LOUD;
+                [[fallthrough]];
+
+            case Stage::LOUD:
+                while (m_idx < m_moves->size()) {
+                    if constexpr (Sorted) {
+                        select_best();
+                    }
+                    const move::FatMove ret = (*m_moves)[m_idx++];
+                    if (ret == m_hash_move) {
+                        continue;
+                    }
+                    if constexpr (Sorted && Type == SearchType::NORMAL) {
+                        if (m_n_bad_loud < max_bad_loud &&
+                            StaticExchange::see(m_node.get().get_astate(),
+                                                ret) < 0) {
+                            m_bad_loud[m_n_bad_loud++] = ret;
+                            continue;
+                        }
+                    }
+                    m_generated = true;
+                    return ret;
+                }
+                if (!m_quiets) {
+                    m_stage = Stage::DONE;
+                    return {};
+                }
+                m_stage = Stage::KILLERS;
+                m_idx = 0;
+                [[fallthrough]];
+
+            case Stage::KILLERS:
+                if constexpr (Sorted) {
+                    while (m_idx < max_killers) {
+                        const move::FatMove ret = m_killers[m_idx++];
+                        if (is_quiet_candidate(ret)) {
+                            m_generated = false;
+                            return ret;
+                        }
+                    }
+                }
+                m_stage = Stage::COUNTERMOVE;
+                [[fallthrough]];
+
+            case Stage::COUNTERMOVE:
+                m_stage = Stage::BAD_LOUD;
+                m_idx = 0;
+                if constexpr (Sorted) {
+                    if (!is_killer(m_countermove) &&
+                        is_quiet_candidate(m_countermove)) {
+                        m_generated = false;
+                        return m_countermove;
+                    }
+                }
+                [[fallthrough]];
+
+            case Stage::BAD_LOUD:
+                if (m_idx < m_n_bad_loud) {
+                    m_generated = true;
+                    return m_bad_loud[m_idx++];
+                }
+                m_stage = Stage::GEN_QUIET;
+                [[fallthrough]];
+
+            case Stage::GEN_QUIET:
+                m_moves =
+                    m_in_check
+                        ? &m_node.get()
+                               .template find_quiet_moves<
+                                   move::movegen::EvasionGenerator>()
+                        : &m_node.get()
+                               .template find_quiet_moves<TMoveGenerator>();
+                if constexpr (Sorted) {
+                    if (m_history) {
+                        const board::Colour side =
+                            m_node.get().get_astate().state.to_move;
+                        for (size_t i = 0; i < m_moves->size(); i++) {
+                            m_scores[i] =
+                                m_history->score(side, (*m_moves)[i]);
+                        }
+                    }
+                }
+                m_idx = 0;
+                m_stage = Stage::QUIET;
+                [[fallthrough]];
+
+            case Stage::QUIET:
+                while (m_idx < m_moves->size()) {
+                    if constexpr (Sorted) {
+                        if (m_history) {
+                            select_best();
+                        }
+                    }
+                    const move::FatMove ret = (*m_moves)[m_idx++];
+                    if (ret != m_hash_move && !is_killer(ret) &&
+                        ret != m_countermove) {
+                        m_generated = true;
+                        return ret;
+                    }
+                }
+                m_stage = Stage::DONE;
+                [[fallthrough]];
+
+            case Stage::DONE:
+                return {};
+        }
+        std::unreachable();
+    }
+
+    // Was the last move yielded found by the generator (rather than only
+    // checked to be pseudo-legal)?
+    bool generated() const { return m_generated; }
+
+    bool is_killer(const move::FatMove mv) const {
+        if constexpr (Sorted) {
+            return std::find(m_killers.begin(), m_killers.end(), mv) !=
+                   m_killers.end();
+        }
+        return false;
     }
 
    private:
-    MvvLva m_mvv_lva;
-    IdentityGt m_hash_move_comparator;
+    enum class Stage : uint8_t {
+        HASH_MOVE,
+        GEN_LOUD,
+        LOUD,
+        KILLERS,
+        COUNTERMOVE,
+        BAD_LOUD,
+        GEN_QUIET,
+        QUIET,
+        DONE,
+    };
+
+    // Partial selection sort: swap the best remaining move into place.
+    void select_best() {
+        size_t best = m_idx;
+        for (size_t i = m_idx + 1; i < m_moves->size(); i++) {
+            if (m_scores[i] > m_scores[best]) {
+                best = i;
+            }
+        }
+        std::swap((*m_moves)[m_idx], (*m_moves)[best]);
+        std::swap(m_scores[m_idx], m_scores[best]);
+    }
+
+    // Killers/countermoves may be stale, so are checked before being yielded.
+    bool is_quiet_candidate(const move::FatMove mv) const {
+        return !mv.is_null() && mv != m_hash_move &&
+               !move::is_capture(mv.get_move().type()) &&
+               move::movegen::AllMoveGenerator::is_pseudo_legal(
+                   m_node.get().get_astate(), mv);
+    }
+
+    std::reference_wrapper<TNode> m_node;
+    move::FatMove m_hash_move{};
+    Killers m_killers;
+    move::FatMove m_countermove{};
+    const ButterflyHistory *m_history = nullptr;
+    bool m_quiets;
+    bool m_in_check;
+
+    Stage m_stage = Stage::HASH_MOVE;
+    MoveBuffer *m_moves = nullptr;
+    size_t m_idx = 0;
+    bool m_generated = false;
+
+    // Only set for sorted stages, left uninitialised otherwise
+    std::array<int, max_moves> m_scores;
+
+    // Once full, losing captures are no longer deferred.
+    static constexpr size_t max_bad_loud = 32;
+    std::array<move::FatMove, max_bad_loud> m_bad_loud;
+    size_t m_n_bad_loud = 0;
 };
 
 //============================================================================//
 // Transposition tables
 //============================================================================//
 
+// Bucketed, lock-free table.
+//
+// Each bucket fills one cache line, and holds several entries of ten bytes:
+// a 64-bit data word, and a 16-bit key check.
+// The key check is stored XOR'd with the data, so an entry torn by concurrent
+// writes fails validation rather than returning another position's data.
+//
+// Entries are aged by a generation counter, incremented by new_search().
 struct TTable {
    public:
     TTable() = default;
-    TTable(size_t n) : m_size(n) {};
+    TTable(size_t n) { resize(n); };
 
     //-- Value/entry types ---------------------------------------------------//
     struct TTValue {
@@ -300,91 +800,214 @@ struct TTable {
         move::FatMove best_move{};
     };
 
-    using TTEntry = std::pair<Zobrist, TTValue>;
-
     //-- Accessors -----------------------------------------------------------//
 
-    const TTValue &operator[](const Zobrist idx) const {
-        return get(idx).second;
-    }
-
-    TTValue &operator[](const Zobrist idx) { return get(idx).second; }
-
-    // Optional accessor
-    const std::optional<TTValue> at_opt(const Zobrist idx) const {
-        return contains(idx) ? get(idx).second : std::optional<TTValue>{};
-    }
-
-    // Extracts the principal variation from a state until miss.
-    template <size_t MaxDepth, size_t HistorySz, typename... TComponents>
-    void get_pv(MoveBuffer &buf,
-                state::SearchNodeWithHistory<MaxDepth, HistorySz,
-                                             TComponents...> &sn) const {
-        sn.prep_search(MaxDepth);
-        buf.clear();
-        Zobrist hash = sn.template get<Zobrist>();
-        while (contains(hash) && !sn.bottomed_out()) {
-            const move::FatMove best_move = get(hash).second.best_move;
-            sn.make_move(best_move);
-            if (best_move.is_null() || sn.is_non_stalemate_draw()) {
-                break;
+    // Depth for results which are exact at any depth (e.g. checkmate).
+    static constexpr uint8_t terminal_depth =
+        std::numeric_limits<uint8_t>::max() - 1;
+
+    // Optional accessor.
+    // Mate scores are stored relative to the node, so are adjusted by the
+    // ply of the node from the root.
+    const std::optional<TTValue> at_opt(const Zobrist idx,
+                                        const size_t ply = 0) const {
+        const Bucket &bucket = get(idx);
+        for (size_t i = 0; i < bucket_size; i++) {
+            const uint64_t data =
+                bucket.data[i].load(std::memory_order::relaxed);
+            if (matches(idx, data,
+                        bucket.keys[i].load(std::memory_order::relaxed))) {
+                TTValue ret = unpack(data);
+                ret.value = adjust_mate(ret.value,
+                                        -static_cast<eval::centipawn_t>(ply));
+                return ret;
             }
-            buf.push_back(best_move);
-            hash = sn.template get<Zobrist>();
         }
-        sn.unmake_all();
+        return {};
     }
 
     // Checks membership
-    bool contains(const Zobrist idx) const { return get(idx).first == idx; }
+    bool contains(const Zobrist idx) const { return at_opt(idx).has_value(); }
 
-    // Inserts result,
-    // if depth of new entry is deeper than an existing entry.
+    // Inserts result, found at the given ply from the root.
+    // An entry for the same position is replaced unless it is from a deeper
+    // search in this generation, otherwise the shallowest/oldest entry
+    // in the bucket is replaced.
+    // A null best move (e.g. from a terminal node) keeps the existing move.
     void insert(const Zobrist idx, const SearchResult result,
-                const uint8_t depth_remaining) {
-        // Do not overwrite results from a deeper search.
-        if (contains(idx) &&
-            // Entries stored depth as depth + 1.
-            get(idx).second.depth_remaining > depth_remaining + 1) {
-            return;
+                const uint8_t depth_remaining, const size_t ply = 0) {
+        Bucket &bucket = get(idx);
+
+        // Entries stored depth as depth + 1.
+        const uint8_t stored_depth = depth_remaining + 1;
+        move::FatMove best_move = result.best_move;
+
+        size_t replace = 0;
+        int worst_priority = std::numeric_limits<int>::max();
+        for (size_t i = 0; i < bucket_size; i++) {
+            const uint64_t data =
+                bucket.data[i].load(std::memory_order::relaxed);
+
+            if (matches(idx, data,
+                        bucket.keys[i].load(std::memory_order::relaxed))) {
+                // Do not overwrite results from a deeper search.
+                if (generation(data) == m_generation &&
+                    unpack(data).depth_remaining > stored_depth) {
+                    return;
+                }
+                if (best_move.is_null()) {
+                    best_move = unpack(data).best_move;
+                }
+                replace = i;
+                break;
+            }
+
+            if (const int priority = replacement_priority(data);
+                priority < worst_priority) {
+                worst_priority = priority;
+                replace = i;
+            }
         }
 
         // Store the new result.
-        get(idx) = {idx, TTValue{.value = result.value,
-                                 .depth_remaining =
-                                     static_cast<uint8_t>(depth_remaining + 1),
-                                 .best_move = result.best_move}};
-    };
+        const uint64_t data = pack(
+            {.value = adjust_mate(result.value,
+                                  static_cast<eval::centipawn_t>(ply)),
+             .depth_remaining = stored_depth,
+             .best_move = best_move});
+        bucket.data[replace].store(data, std::memory_order::relaxed);
+        bucket.keys[replace].store(key_check(idx, data),
+                                   std::memory_order::relaxed);
+    }
+
+    // Ages existing entries, call before each search.
+    void new_search() { m_generation = (m_generation + 1) & generation_mask; }
 
     void clear() {
-        m_entries.clear();
-        m_entries.resize(m_size);
+        for (size_t i = 0; i < m_n_buckets; i++) {
+            for (size_t j = 0; j < bucket_size; j++) {
+                m_buckets[i].data[j].store(0, std::memory_order::relaxed);
+                m_buckets[i].keys[j].store(0, std::memory_order::relaxed);
+            }
+        }
+        m_generation = 0;
     }
 
+    // Resize to hold (at least one bucket, and) at most n entries.
     void resize(size_t n) {
-        m_size = n;
-        clear();
-        m_entries.shrink_to_fit();
+        m_n_buckets = std::max<size_t>(n / bucket_size, 1);
+        m_buckets = std::make_unique<Bucket[]>(m_n_buckets);
+        m_generation = 0;
     }
 
-    void resize_mb(size_t n) { return resize(n * kb * kb / sizeof(TTEntry)); }
+    void resize_mb(size_t n) {
+        return resize(n * kb * kb / sizeof(Bucket) * bucket_size);
+    }
 
    private:
-    // Access helper.
-    TTEntry &get(const Zobrist idx) {
-        return m_entries[static_cast<size_t>(idx) % m_size];
+    //-- Storage -------------------------------------------------------------//
+
+    static constexpr size_t cache_line = 64;
+    static constexpr size_t bucket_size = 6;
+
+    struct alignas(cache_line) Bucket {
+        std::array<std::atomic<uint64_t>, bucket_size> data;
+        std::array<std::atomic<uint16_t>, bucket_size> keys;
+    };
+    static_assert(sizeof(Bucket) == cache_line);
+
+    // Access helper: multiply-shift the upper hash bits onto the table.
+    Bucket &get(const Zobrist idx) {
+        return m_buckets[((static_cast<uint64_t>(idx) >> 32) * m_n_buckets) >>
+                         32];
     }
 
     // Access helper.
-    const TTEntry &get(const Zobrist idx) const {
-        return m_entries[static_cast<size_t>(idx) % m_size];
+    const Bucket &get(const Zobrist idx) const {
+        return m_buckets[((static_cast<uint64_t>(idx) >> 32) * m_n_buckets) >>
+                         32];
+    }
+
+    //-- Packing -------------------------------------------------------------//
+
+    // Moves mate scores further from the root by the given number of plies.
+    static IBValue adjust_mate(const IBValue value,
+                               const eval::centipawn_t plies) {
+        const eval::centipawn_t score = value.eval();
+        if (!eval::is_mate(score)) {
+            return value;
+        }
+        return IBValue(score > 0 ? score + plies : score - plies,
+                       value.node_type());
+    }
+
+    // Data layout, from least significant bit:
+    // * 32 bits: IBValue
+    // * 16 bits: move
+    // * 8 bits: depth + 1
+    // * 3 bits: piece
+    // * 5 bits: generation
+    static constexpr size_t move_offset = 32;
+    static constexpr size_t depth_offset = 48;
+    static constexpr size_t piece_offset = 56;
+    static constexpr size_t generation_offset = 59;
+    static constexpr uint8_t generation_mask = 0b11111;
+
+    uint64_t pack(const TTValue value) const {
+        return static_cast<uint32_t>(
+                   static_cast<eval::centipawn_t>(value.value)) |
+               static_cast<uint64_t>(static_cast<move::move_t>(
+                   value.best_move.get_move()))
+                   << move_offset |
+               static_cast<uint64_t>(value.depth_remaining) << depth_offset |
+               static_cast<uint64_t>(value.best_move.get_piece())
+                   << piece_offset |
+               static_cast<uint64_t>(m_generation) << generation_offset;
+    }
+
+    static TTValue unpack(const uint64_t data) {
+        return {.value = IBValue(static_cast<eval::centipawn_t>(
+                    static_cast<uint32_t>(data))),
+                .depth_remaining = static_cast<uint8_t>(data >> depth_offset),
+                .best_move = move::FatMove(
+                    move::Move(static_cast<move::move_t>(data >> move_offset)),
+                    static_cast<board::Piece>((data >> piece_offset) & 0b111))};
+    }
+
+    static uint8_t generation(const uint64_t data) {
+        return static_cast<uint8_t>(data >> generation_offset);
+    }
+
+    // Lower 16 hash bits, XOR'd with every 16 bits of data.
+    static uint16_t key_check(const Zobrist idx, const uint64_t data) {
+        return static_cast<uint16_t>(static_cast<uint64_t>(idx) ^ data ^
+                                     (data >> 16) ^ (data >> 32) ^
+                                     (data >> 48));
+    }
+
+    static bool matches(const Zobrist idx, const uint64_t data,
+                        const uint16_t key) {
+        // Empty entries have depth 0.
+        return key == key_check(idx, data) &&
+               static_cast<uint8_t>(data >> depth_offset);
+    }
+
+    // Lowest priority is replaced first:
+    // each generation of age costs as much as a few plies of depth.
+    int replacement_priority(const uint64_t data) const {
+        static constexpr int age_weight = 4;
+        const int age = (m_generation - generation(data)) & generation_mask;
+        return static_cast<int>(unpack(data).depth_remaining) -
+               age_weight * age;
     }
 
-    // TODO: make resizable
     static constexpr size_t kb = 1024;
-    size_t m_size = kb * kb / sizeof(TTEntry);
+    size_t m_n_buckets = kb * kb / sizeof(Bucket);
+    std::unique_ptr<Bucket[]> m_buckets =
+        std::make_unique<Bucket[]>(m_n_buckets);
 
-    std::vector<TTEntry> m_entries = std::vector<TTEntry>(m_size, {{}, {}});
+    // Written only between searches
+    uint8_t m_generation = 0;
 };
 
 //============================================================================//
@@ -410,6 +1033,42 @@ struct NegaMaxOptions {
     bool quiescence_standpat = true;
     bool use_hash = true;
     bool hash_pruning = true;
+    bool pvs = true;                // requires prune
+    bool null_move = true;          // requires pvs
+    bool lmr = true;                // requires prune
+    bool see_pruning = true;        // requires quiesce
+    bool quiet_checks = true;       // requires quiesce
+    bool delta_pruning = true;      // requires quiescence_standpat
+    bool reverse_futility = true;   // requires pvs
+    bool razoring = true;           // requires pvs and quiesce
+    bool futility = true;           // requires pvs
+    bool late_move_pruning = true;  // requires pvs
+    bool check_extensions = true;
+    bool recapture_extensions = true;
+    bool singular_extensions = true;  // requires prune and use_hash
+    bool multi_cut = true;            // requires singular_extensions and pvs
+    bool probcut = true;              // requires pvs and quiesce
+    bool iir = true;                  // requires use_hash
+    bool legal_movegen = false;
+};
+
+// Margins which may be tuned at runtime, e.g. by self-play.
+struct SearchParams {
+    eval::centipawn_t probcut_margin = 200;
+    eval::centipawn_t singular_margin = 3;  // per ply
+};
+
+// Search depth, in fractions of a ply,
+// so reductions and extensions need not be whole plies.
+using depth_t = int;
+constexpr depth_t one_ply = 4;
+
+// Whether a node may be in the principal variation.
+// Only PV nodes are searched with an open window under PVS,
+// other nodes are searched with a null window.
+enum class PVType : bool {
+    NON_PV,
+    PV,
 };
 
 enum class VerbosityLevel : bool {
@@ -424,16 +1083,26 @@ class DLNegaMax {
 
         : m_node(node), m_ttable(ttable) {};
 
+    // Sets the depth of the next search.
+    // The node may be searched as deep as its buffers allow,
+    // depth is passed explicitly to each call.
     constexpr void set_depth(size_t depth) {
         assert(depth <= MaxDepth);
-        m_node.get().prep_search(depth);
+        m_depth = depth;
+        m_node.get().prep_search(MaxDepth);
 
         m_stopped.store(false, std::memory_order::relaxed);
-        m_nodes_since_time_check = 0;
-        m_node_count = 0;
+        m_nodes_since_limit_check = 0;
+        m_best_move_nodes = 0;
+        m_root_nodes = 0;
+        m_null_move_min_ply = 0;
+        m_node_count.store(0, std::memory_order::relaxed);
     }
 
-    constexpr size_t get_node_count() const { return m_node_count; }
+    // May be called from another thread during search.
+    constexpr size_t get_node_count() const {
+        return m_node_count.load(std::memory_order::relaxed);
+    }
 
     constexpr const DefaultNode<TEval, MaxDepth> &get_node() const {
         return m_node;
@@ -444,33 +1113,104 @@ class DLNegaMax {
         return m_stopped.load(std::memory_order::relaxed);
     }
 
-    constexpr void set_finish_time(
-        const std::optional<std::chrono::time_point<std::chrono::steady_clock>>
-            finish_time = std::nullopt) {
-        m_finish_time.store(finish_time, std::memory_order::relaxed);
-    }
+    // Nodes searched below the best root move in the last search().
+    constexpr size_t get_best_move_nodes() const { return m_best_move_nodes; }
 
-    constexpr std::optional<std::chrono::time_point<std::chrono::steady_clock>>
-    get_finish_time() const {
-        return m_finish_time.load(std::memory_order::relaxed);
+    // Nodes searched in the last search() (unlike get_node_count(), not
+    // including earlier searches since set_depth()).
+    constexpr size_t get_root_nodes() const { return m_root_nodes; }
+
+    // Stops once this many nodes have been searched since set_depth().
+    // Checked periodically, so may overshoot by up to limit_check_freq.
+    // Must not be called during search.
+    constexpr void set_node_limit(const std::optional<size_t> node_limit) {
+        m_node_limit = node_limit;
     }
 
     template <SearchType Type = SearchType::NORMAL,
               VerbosityLevel Verbosity = VerbosityLevel::QUIET,
-              NegaMaxOptions Opts = {}>
+              NegaMaxOptions Opts = {}, PVType PV = PVType::PV>
+    constexpr SearchResult search(Bounds bounds = {},
+                                  const StatReporter *reporter = nullptr) {
+        const size_t nodes_before = get_node_count();
+        const SearchResult ret = negamax<Type, Verbosity, Opts, PV>(
+            bounds, static_cast<depth_t>(m_depth) * one_ply, reporter);
+        m_root_nodes = get_node_count() - nodes_before;
+        return ret;
+    }
+
+    template <VerbosityLevel Verbosity, NegaMaxOptions Opts = {}>
+    constexpr SearchResult search(Bounds bounds = {},
+                                  const StatReporter *reporter = nullptr) {
+        return search<SearchType::NORMAL, Verbosity, Opts>(bounds, reporter);
+    }
+
+    template <NegaMaxOptions Opts>
     constexpr SearchResult search(Bounds bounds = {},
                                   const StatReporter *reporter = nullptr) {
-        // Auto-stop
-        if (m_nodes_since_time_check > time_check_freq) {
-            if (get_finish_time().has_value() &&
-                std::chrono::steady_clock::now() > get_finish_time()) {
+        return search<SearchType::NORMAL, VerbosityLevel::QUIET, Opts>(
+            bounds, reporter);
+    }
+
+    // Principal variation of the last search.
+    void get_pv(MoveBuffer &buf) const {
+        buf.clear();
+        for (size_t i = 0; i < m_pv_length[0]; i++) {
+            buf.push_back(m_pv_table[0][i]);
+        }
+    }
+
+    // Call before a new root search (not each iteration),
+    // ages move ordering tables.
+    constexpr void new_search() { m_ordering.age(); }
+
+    // Legal moves at the root, in generation order.
+    constexpr void find_root_moves(MoveBuffer &buf) {
+        buf.clear();
+        for (const move::FatMove m : m_node.get().find_moves()) {
+            if (m_node.get().make_move(m)) {
+                buf.push_back(m);
+            }
+            m_node.get().unmake_move();
+        }
+    }
+
+    // Only the given (legal) moves are searched at the root, in order.
+    // If empty, all moves are searched, ordered as at any other node.
+    // Must not be called during search.
+    constexpr void set_root_moves(const MoveBuffer &moves) {
+        m_root_moves = moves;
+    }
+
+    // Must not be called during search.
+    constexpr void set_params(const SearchParams &params) { m_params = params; }
+    constexpr const SearchParams &get_params() const { return m_params; }
+
+   private:
+    // Moves are generated legally, or pseudo-legally and checked when made.
+    template <NegaMaxOptions Opts>
+    using MoveGenerator =
+        std::conditional_t<Opts.legal_movegen,
+                           move::movegen::LegalMoveGenerator,
+                           move::movegen::AllMoveGenerator>;
+
+    template <SearchType Type, VerbosityLevel Verbosity, NegaMaxOptions Opts,
+              PVType PV>
+    constexpr SearchResult negamax(Bounds bounds, depth_t depth,
+                                   const StatReporter *reporter) {
+        // Auto-stop (time limits stop the search from another thread)
+        if (m_nodes_since_limit_check > limit_check_freq) {
+            if (m_node_limit.has_value() &&
+                get_node_count() >= m_node_limit.value()) {
                 stop();
             }
-            m_nodes_since_time_check = 0;
+            m_nodes_since_limit_check = 0;
         }
 
-        m_node_count++;
-        m_nodes_since_time_check++;
+        count_nodes(1);
+        m_nodes_since_limit_check++;
+        const size_t ply = m_node.get().depth();
+        m_pv_length[ply] = 0;
 
         if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
             if (reporter) {
@@ -483,7 +1223,7 @@ class DLNegaMax {
         }
 
         // Early return
-        if (m_stopped) {
+        if (is_stopped()) {
             return {.type = SearchResult::LeafType::TIMEOUT};
         }
 
@@ -505,13 +1245,37 @@ class DLNegaMax {
             return {.type = SearchResult::LeafType::DRAW};
         }
 
+        // Mate distance pruning:
+        // no line from here mates sooner than the next ply,
+        // nor is mated sooner than this one.
+        if constexpr (Opts.prune) {
+            if (ply > 0) {
+                const eval::centipawn_t mated = -eval::mate_score(ply);
+                const eval::centipawn_t mating = eval::mate_score(ply + 1);
+                if (mated >= bounds.beta) {
+                    return {.value = IBValue(mated, ABNodeType::CUT),
+                            .type = SearchResult::LeafType::DEPTH_CUTOFF};
+                }
+                if (mating <= bounds.alpha) {
+                    return {.value = IBValue(mating, ABNodeType::ALL),
+                            .type = SearchResult::LeafType::DEPTH_CUTOFF};
+                }
+                bounds.alpha = std::max(bounds.alpha, mated);
+                bounds.beta = std::min(bounds.beta, mating);
+            }
+        }
+
         // Cutoff -> return value
-        if (m_node.get().template bottomed_out<Type>()) {
+        // Normal search also stops at the maximum ply of the node.
+        if ((Type == SearchType::NORMAL && depth < one_ply) ||
+            m_node.get().template bottomed_out<Type>()) {
             // Normal search -> quiesce
             if constexpr (Type == SearchType::NORMAL && Opts.quiesce) {
-                m_node_count--;  // avod double counting root node of quiescence
-                SearchResult ret = search<SearchType::QUIESCE, Verbosity, Opts>(
-                    bounds, reporter);
+                // avod double counting root node of quiescence
+                count_nodes(-1);
+                SearchResult ret =
+                    negamax<SearchType::QUIESCE, Verbosity, Opts, PV>(
+                        bounds, 0, reporter);
                 return ret;
             } else {
                 SearchResult ret = cutoff_result();
@@ -527,14 +1291,21 @@ class DLNegaMax {
             }
         }
 
+        // Whole plies remaining, as stored in the transposition table
+        size_t depth_remaining = Type == SearchType::QUIESCE
+                                     ? 0
+                                     : static_cast<size_t>(depth / one_ply);
+
         // Values for search result
         std::optional<SearchResult> best_move;
+        const bool in_check = m_node.get().is_checked();
 
         // In quiescence only: check stand-pat score
+        // (not in check, where every evasion is searched instead).
+        eval::centipawn_t standpat_score = no_static_eval;
         if constexpr (Type == SearchType::QUIESCE && Opts.quiescence_standpat) {
-            if (!m_node.get().is_checked()) {
-                const eval::centipawn_t standpat_score =
-                    m_node.get().template get<TEval>().eval();
+            if (!in_check) {
+                standpat_score = m_node.get().template get<TEval>().eval();
                 SearchResult standpat_result = {
                     .value = IBValue(standpat_score, ABNodeType::CUT),
                     .type = SearchResult::LeafType::DEPTH_CUTOFF,
@@ -556,24 +1327,31 @@ class DLNegaMax {
             }
         }
 
+        // Move excluded from a singular extension search of this node
+        const move::FatMove excluded_move = m_excluded[m_node.get().depth()];
+
         // Get hash move
         const Zobrist hash = m_node.get().template get<Zobrist>();
         move::FatMove hash_move;
+        std::optional<TTable::TTValue> tt_value;
 
         if constexpr (Opts.use_hash) {
-            const std::optional<TTable::TTValue> tt_value =
-                m_ttable.get().at_opt(hash);
+            tt_value = m_ttable.get().at_opt(hash, ply);
             hash_move =
                 tt_value.transform([](auto val) { return val.best_move; })
                     .value_or(move::FatMove{});
 
             if constexpr (Opts.hash_pruning) {
-                // Has deeper value
-                if (tt_value &&
-                    tt_value->depth_remaining >=
-                        m_node.get().template depth_remaining<Type>() + 1) {
+                // Has deeper value.
+                // Never cut at the root: the move returned must have been
+                // searched, since other threads may be writing to the table.
+                // Nor at PV nodes, which would truncate the PV,
+                // nor when a move is excluded.
+                if (PV == PVType::NON_PV && excluded_move.is_null() &&
+                    tt_value &&
+                    m_node.get().depth() > 0 &&
+                    tt_value->depth_remaining >= depth_remaining + 1) {
                     // TODO: check for repettions first
-                    // TODO: handle null moves from mates
                     if (tt_value->value.exact() ||
                         (tt_value->value.node_type() == ABNodeType::CUT &&
                          tt_value->value.eval() >= bounds.beta) ||
@@ -597,66 +1375,335 @@ class DLNegaMax {
             }
         }
 
-        // Get children (in order)
-        MoveBuffer &moves = search_moves<Type>();
-        if constexpr (Opts.sort) {
-            std::sort(moves.begin(), moves.end(),
-                      [this, hash_move](const move::FatMove a,
-                                        const move::FatMove b) {
-                          const bool ret = DefaultOrdering(
-                              m_node.get().get_astate(), hash_move)(a, b);
-                          if constexpr (DEBUG()) {
-                              assert(!(ret && DefaultOrdering(
-                                                  m_node.get().get_astate(),
-                                                  hash_move)(b, a)));
-                              assert(!(DefaultOrdering(
-                                  m_node.get().get_astate(), hash_move)(a, a)));
-                              assert(!(DefaultOrdering(
-                                  m_node.get().get_astate(), hash_move)(b, b)));
-                          }
-                          return ret;
-                      });
+        // Internal iterative reduction
+        if constexpr (Type == SearchType::NORMAL && Opts.use_hash &&
+                      Opts.iir) {
+            if (iir_allowed(depth_remaining, hash_move, excluded_move, ply)) {
+                depth -= iir_reduction;
+                depth_remaining = static_cast<size_t>(depth / one_ply);
+            }
         }
 
-        // Recurse
-        for (const move::FatMove m : moves) {
-            // Early return from recursion
-            if (m_stopped) {
-                return {.type = SearchResult::LeafType::TIMEOUT};
+        // Static evaluation, for forward pruning
+        eval::centipawn_t static_eval = no_static_eval;
+        bool improving = false;
+        if constexpr (Type == SearchType::NORMAL) {
+            if (!in_check) {
+                static_eval = m_node.get().template get<TEval>().eval();
             }
+            m_static_eval[ply] = static_eval;
+            improving = is_improving(ply);
+        }
 
-            // Check child
-            if (m_node.get().make_move(m)) {
+        // Forward pruning is only done away from the PV
+        constexpr bool forward_pruning = Type == SearchType::NORMAL &&
+                                         PV == PVType::NON_PV && Opts.prune &&
+                                         Opts.pvs;
+        const bool can_prune = forward_pruning && !in_check && ply > 0;
+
+        // Reverse futility pruning
+        if constexpr (forward_pruning && Opts.reverse_futility) {
+            if (can_prune && reverse_futile(bounds, depth_remaining,
+                                            static_eval, improving)) {
                 if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
                     if (reporter) {
                         reporter->debug_log(StatReporter::join(
-                            StatReporter::prefix(m_node.get().depth() - 1),
-                            "searching move: ", m.pretty(), " {\n"));
+                            StatReporter::prefix(ply),
+                            "reverse futility cutoff, score: ",
+                            std::to_string(static_eval), " }\n"));
                     }
                 }
-                const SearchResult child_result = search<Type, Verbosity, Opts>(
-                    {-bounds.beta, -bounds.alpha}, reporter);
+                return {.value = IBValue(static_eval, ABNodeType::CUT),
+                        .type = SearchResult::LeafType::DEPTH_CUTOFF,
+                        .best_move = {}};
+            }
+        }
 
-                if constexpr (Type == SearchType::QUIESCE) {
-                    assert(move::is_capture(m.get_move().type()));
+        // Razoring
+        if constexpr (forward_pruning && Opts.razoring && Opts.quiesce) {
+            if (can_prune && depth_remaining <= razoring_max_depth &&
+                static_eval +
+                        (razoring_margin *
+                         static_cast<eval::centipawn_t>(depth_remaining)) <
+                    bounds.alpha) {
+                count_nodes(-1);  // avoid double counting this node
+                const SearchResult razor_result =
+                    negamax<SearchType::QUIESCE, Verbosity, Opts, PV>(
+                        bounds, 0, reporter);
+                if (razor_result.type == SearchResult::LeafType::TIMEOUT ||
+                    razor_result.value <=
+                        IBValue(bounds.alpha, ABNodeType::PV)) {
+                    if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
+                        if (reporter) {
+                            reporter->debug_log(StatReporter::join(
+                                StatReporter::prefix(ply),
+                                "razoring cutoff, score: ",
+                                std::to_string(razor_result.value.eval()),
+                                " }\n"));
+                        }
+                    }
+                    return razor_result;
                 }
+            }
+        }
 
-                // Count nodes
-                const IBValue child_value = -child_result.value;
+        // Null-move pruning
+        if constexpr (Type == SearchType::NORMAL && PV == PVType::NON_PV &&
+                      Opts.prune && Opts.pvs && Opts.null_move) {
+            if (excluded_move.is_null() &&
+                null_move_allowed(bounds, depth, in_check, static_eval)) {
+                const std::optional<SearchResult> null_move_result =
+                    null_move_search<Verbosity, Opts>(bounds, depth, reporter);
+                if (null_move_result.has_value()) {
+                    return null_move_result.value();
+                }
+            }
+        }
 
-                // Update best move if eval improves
-                if (!(best_move.has_value()) ||
-                    child_value > best_move->value) {
-                    best_move = {.value = child_value,
-                                 .type = child_result.type,
-                                 .best_move = m};  // count nodes later
+        // ProbCut
+        if constexpr (forward_pruning && Opts.probcut && Opts.quiesce) {
+            if (can_prune && excluded_move.is_null() &&
+                probcut_allowed(bounds, depth, tt_value)) {
+                const std::optional<SearchResult> probcut_result =
+                    probcut_search<Verbosity, Opts>(bounds, depth, hash_move,
+                                                    reporter);
+                if (probcut_result.has_value()) {
+                    return probcut_result.value();
                 }
+            }
+        }
 
-                if constexpr (Opts.prune) {
+        // Singular extensions and multi-cut
+        bool singular = false;
+        const bool extensions_allowed = ply < 2 * m_depth;
+        if constexpr (Type == SearchType::NORMAL && Opts.prune &&
+                      Opts.use_hash && Opts.singular_extensions) {
+            if (excluded_move.is_null() &&
+                (extensions_allowed ||
+                 (PV == PVType::NON_PV && Opts.pvs && Opts.multi_cut)) &&
+                singular_allowed(depth_remaining, hash_move, tt_value)) {
+                const eval::centipawn_t singular_beta =
+                    tt_value->value.eval() -
+                    (m_params.singular_margin *
+                     static_cast<eval::centipawn_t>(depth_remaining));
+                const SearchResult excluded_result =
+                    excluded_search<Verbosity, Opts>(depth, hash_move,
+                                                     singular_beta, reporter);
+                if (excluded_result.type == SearchResult::LeafType::TIMEOUT) {
+                    return excluded_result;
+                }
+                singular = extensions_allowed &&
+                           excluded_result.value.eval() < singular_beta;
+
+                // Multi-cut: some other move also beats beta
+                if constexpr (PV == PVType::NON_PV && Opts.pvs &&
+                              Opts.multi_cut) {
+                    if (!singular && singular_beta >= bounds.beta &&
+                        excluded_result.value.eval() >= singular_beta) {
+                        if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
+                            if (reporter) {
+                                reporter->debug_log(StatReporter::join(
+                                    StatReporter::prefix(ply),
+                                    "multi-cut, score: ",
+                                    std::to_string(singular_beta), " }\n"));
+                            }
+                        }
+                        return {
+                            .value = IBValue(singular_beta, ABNodeType::CUT),
+                            .type = SearchResult::LeafType::DEPTH_CUTOFF,
+                            .best_move = {}};
+                    }
+                }
+            }
+        }
+
+        // Get children (in order)
+        const board::Colour side = m_node.get().get_astate().state.to_move;
+        const move::FatMove prev_move = m_node.get().last_move();
+        // In quiescence, quiet moves are searched if in check (evasions),
+        // or if they give check at the first ply (unordered, since most are
+        // skipped).
+        const bool quiet_checks = Type == SearchType::QUIESCE &&
+                                  Opts.quiet_checks && !in_check && depth >= 0;
+        MovePicker<Type, Opts.sort, DefaultNode<TEval, MaxDepth>,
+                   MoveGenerator<Opts>>
+            picker(m_node, hash_move, m_ordering.killers(ply),
+                   m_ordering.countermove(side, prev_move),
+                   quiet_checks ? nullptr : &m_ordering.history(),
+                   Type == SearchType::NORMAL || in_check || quiet_checks,
+                   in_check);
+
+        // Quiet moves searched before a cutoff, for history maluses
+        SVec<move::FatMove, max_tracked_quiets> quiets_tried;
+
+        // In quiescence, moves losing material are skipped (unless in
+        // check, since they may be the only evasions).
+        const bool see_pruning =
+            Type == SearchType::QUIESCE && Opts.see_pruning && !in_check;
+
+        // The root may be restricted to a list of moves
+        const bool root_restricted = ply == 0 && m_root_moves.size() > 0;
+        size_t root_idx = 0;
+        const auto next_move_of = [&]() -> std::optional<move::FatMove> {
+            if (root_restricted) {
+                if (root_idx < m_root_moves.size()) {
+                    return m_root_moves[root_idx++];
+                }
+                return {};
+            }
+            return picker.next();
+        };
+
+        // Recurse
+        size_t n_searched = 0;
+        while (const std::optional<move::FatMove> next_move = next_move_of()) {
+            const move::FatMove m = next_move.value();
+
+            // Early return from recursion
+            if (is_stopped()) {
+                return {.type = SearchResult::LeafType::TIMEOUT};
+            }
+
+            if (m == excluded_move) {
+                continue;
+            }
+
+            // Quiet moves may be pruned once some move has been searched,
+            // unless all moves so far lose to mate.
+            const bool prunable_quiet =
+                can_prune && best_move.has_value() &&
+                best_move->value.eval() > -eval::mate_threshold &&
+                !move::is_capture(m.get_move().type()) &&
+                !move::is_promotion(m.get_move().type());
+
+            // Late move pruning
+            if constexpr (forward_pruning && Opts.late_move_pruning) {
+                if (prunable_quiet && depth_remaining <= lmp_max_depth &&
+                    n_searched >= lmp_move_count(depth_remaining, improving)) {
+                    if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
+                        if (reporter) {
+                            reporter->debug_log(StatReporter::join(
+                                StatReporter::prefix(ply),
+                                "late move pruning: ", m.pretty(), "\n"));
+                        }
+                    }
+                    continue;
+                }
+            }
+
+            // Delta pruning
+            if constexpr (Type == SearchType::QUIESCE && Opts.delta_pruning &&
+                          Opts.quiescence_standpat) {
+                if (delta_prunable(bounds, standpat_score, m)) {
+                    continue;
+                }
+            }
+
+            // Quiet moves not giving check are skipped
+            if (quiet_checks && !move::is_capture(m.get_move().type()) &&
+                !m_node.get().gives_check(m)) {
+                continue;
+            }
+
+            if (see_pruning &&
+                StaticExchange::see(m_node.get().get_astate(), m) < 0) {
+                continue;
+            }
+
+            // Futility pruning (of moves not giving check)
+            if constexpr (forward_pruning && Opts.futility) {
+                if (prunable_quiet && depth_remaining <= futility_max_depth &&
+                    static_eval + futility_margin(depth_remaining) <=
+                        bounds.alpha &&
+                    !m_node.get().gives_check(m)) {
+                    if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
+                        if (reporter) {
+                            reporter->debug_log(StatReporter::join(
+                                StatReporter::prefix(ply),
+                                "futility pruning: ", m.pretty(), "\n"));
+                        }
+                    }
+                    continue;
+                }
+            }
+
+            // Checks are extended unless they lose material, found before
+            // the move is made
+            bool safe_check = false;
+            if constexpr (Type == SearchType::NORMAL && Opts.check_extensions) {
+                safe_check =
+                    extensions_allowed && m_node.get().gives_check(m) &&
+                    StaticExchange::see(m_node.get().get_astate(), m) >= 0;
+            }
+
+            // Check child (generated moves are already known to be legal
+            // with the legal generator, or if evading check)
+            const bool checked = !(Opts.legal_movegen || in_check) ||
+                                 root_restricted || !picker.generated();
+            if (checked ? m_node.get().make_move(m)
+                        : m_node.get().template make_move<false>(m)) {
+                if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
+                    if (reporter) {
+                        reporter->debug_log(StatReporter::join(
+                            StatReporter::prefix(m_node.get().depth() - 1),
+                            "searching move: ", m.pretty(), " {\n"));
+                    }
+                }
+                depth_t extension = 0;
+                if constexpr (Type == SearchType::NORMAL) {
+                    if (extensions_allowed) {
+                        extension = move_extension<Opts>(
+                            m, prev_move, safe_check,
+                            singular && m == hash_move);
+                    }
+                }
+                depth_t reduction = 0;
+                if constexpr (Type == SearchType::NORMAL && Opts.prune &&
+                              Opts.lmr) {
+                    reduction = late_move_reduction<PV>(
+                        m, depth, n_searched, in_check, picker.is_killer(m));
+                }
+                const size_t nodes_before = ply == 0 ? get_node_count() : 0;
+                const SearchResult child_result =
+                    search_child<Type, Verbosity, Opts, PV>(
+                        bounds, depth - one_ply + extension, reduction,
+                        n_searched, reporter);
+                n_searched++;
+
+                if constexpr (Type == SearchType::QUIESCE) {
+                    assert(in_check || quiet_checks ||
+                           move::is_capture(m.get_move().type()));
+                }
+
+                // Count nodes
+                const IBValue child_value = -child_result.value;
+
+                // Update best move if eval improves
+                if (!(best_move.has_value()) ||
+                    child_value > best_move->value) {
+                    best_move = {.value = child_value,
+                                 .type = child_result.type,
+                                 .best_move = m};  // count nodes later
+                    if constexpr (PV == PVType::PV) {
+                        update_pv(ply, m);
+                    }
+                    if (ply == 0) {
+                        m_best_move_nodes = get_node_count() - nodes_before;
+                    }
+                }
+
+                if constexpr (Opts.prune) {
                     if (child_value > IBValue(bounds.alpha, ABNodeType::PV)) {
                         bounds.alpha = child_value.eval();
                     }
                     if (child_value >= IBValue(bounds.beta, ABNodeType::PV)) {
+                        if constexpr (Type == SearchType::NORMAL && Opts.sort) {
+                            if (!move::is_capture(m.get_move().type())) {
+                                m_ordering.update(ply, depth_remaining, side,
+                                                  prev_move, m, quiets_tried);
+                            }
+                        }
+
                         // Pruned -> return lower bound
                         m_node.get().unmake_move();
                         best_move->value =
@@ -671,14 +1718,29 @@ class DLNegaMax {
                         break;
                     }
                 }
+
+                if constexpr (Type == SearchType::NORMAL && Opts.sort) {
+                    if (!move::is_capture(m.get_move().type()) &&
+                        quiets_tried.size() < max_tracked_quiets) {
+                        quiets_tried.push_back(m);
+                    }
+                }
             }
             m_node.get().unmake_move();
         }
 
         if (!best_move) {
-            // If no result in quiescence search: search quiet moves.
+            // Only move excluded: fail low
+            if (!excluded_move.is_null()) {
+                return {.value = IBValue(bounds.alpha, ABNodeType::ALL),
+                        .type = SearchResult::LeafType::DEPTH_CUTOFF,
+                        .best_move = {}};
+            }
+
+            // If no result in quiescence search (not in check, so every
+            // evasion was searched): stalemates are not detected.
             if constexpr (Type == SearchType::QUIESCE) {
-                if (quiet_moves_exist()) {
+                if (!in_check) {
                     SearchResult ret = cutoff_result();
                     if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
                         if (reporter) {
@@ -693,28 +1755,15 @@ class DLNegaMax {
             }
 
             // Stale/checkmate
-            const board::Square king_sq =
-                m_node.get()
-                    .get_astate()
-                    .state
-                    .copy_bitboard(
-                        {.colour = m_node.get().get_astate().state.to_move,
-                         .piece = board::Piece::KING})
-                    .single_bitscan_forward();
-
-            const bool checked = move::movegen::AllMoveGenerator::is_attacked(
-                m_node.get().get_astate(), king_sq,
-                m_node.get().get_astate().state.to_move);
-
             const SearchResult endgame_result = {
-                .value = IBValue(checked ? -eval::max_eval : 0, ABNodeType::PV),
-                .type = checked ? SearchResult::LeafType::CHECKMATE
-                                : SearchResult::LeafType::STALEMATE};
-            // TODO: insert these
-            // But, handle the fact that we have null moves in the cache
-            // now. m_ttable.get().insert(
-            //     hash, endgame_result,
-            //     m_node.get().template depth_remaining<Type>());
+                .value = IBValue(in_check ? -eval::mate_score(ply) : 0,
+                                 ABNodeType::PV),
+                .type = in_check ? SearchResult::LeafType::CHECKMATE
+                                 : SearchResult::LeafType::STALEMATE};
+
+            // Exact at any depth
+            m_ttable.get().insert(hash, endgame_result, TTable::terminal_depth,
+                                  ply);
 
             if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
                 if (reporter) {
@@ -727,10 +1776,11 @@ class DLNegaMax {
             return endgame_result;
         }
 
-        m_ttable.get().insert(
-            hash, best_move.value(),
-            static_cast<uint8_t>(
-                m_node.get().template depth_remaining<Type>()));
+        // Results with moves excluded are not the node's value
+        if (excluded_move.is_null() && !root_restricted) {
+            m_ttable.get().insert(hash, best_move.value(),
+                                  static_cast<uint8_t>(depth_remaining), ply);
+        }
         if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
             if (reporter) {
                 reporter->debug_log(StatReporter::join(
@@ -742,63 +1792,515 @@ class DLNegaMax {
         return best_move.value();
     }
 
-    template <VerbosityLevel Verbosity, NegaMaxOptions Opts = {}>
-    constexpr SearchResult search(Bounds bounds = {},
-                                  const StatReporter *reporter = nullptr) {
-        return search<SearchType::NORMAL, Verbosity, Opts>(bounds, reporter);
+    // Principal variation search:
+    // in normal search at PV nodes, only the first child is searched with the
+    // full window. Later children are searched with a null window, and only
+    // re-searched with the full window if they fall inside it.
+    // Reduced children are searched with a null window first, and re-searched
+    // to the full depth if they beat alpha.
+    // Assumes the child has been made.
+    template <SearchType Type, VerbosityLevel Verbosity, NegaMaxOptions Opts,
+              PVType PV>
+    constexpr SearchResult search_child(const Bounds bounds,
+                                        const depth_t depth,
+                                        const depth_t reduction,
+                                        const size_t n_searched,
+                                        const StatReporter *reporter) {
+        if (reduction > 0) {
+            const SearchResult reduced_result =
+                negamax<Type, Verbosity, Opts, PVType::NON_PV>(
+                    {-bounds.alpha - 1, -bounds.alpha}, depth - reduction,
+                    reporter);
+            if (reduced_result.type == SearchResult::LeafType::TIMEOUT ||
+                -reduced_result.value <=
+                    IBValue(bounds.alpha, ABNodeType::PV)) {
+                return reduced_result;
+            }
+            if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
+                if (reporter) {
+                    reporter->debug_log(StatReporter::join(
+                        StatReporter::prefix(m_node.get().depth() - 1),
+                        "re-searching without reduction\n"));
+                }
+            }
+        }
+
+        if constexpr (Type == SearchType::NORMAL && PV == PVType::PV &&
+                      Opts.prune && Opts.pvs) {
+            if (n_searched) {
+                const SearchResult null_window_result =
+                    negamax<Type, Verbosity, Opts, PVType::NON_PV>(
+                        {-bounds.alpha - 1, -bounds.alpha}, depth, reporter);
+                const IBValue child_value = -null_window_result.value;
+                if (null_window_result.type ==
+                        SearchResult::LeafType::TIMEOUT ||
+                    child_value <= IBValue(bounds.alpha, ABNodeType::PV) ||
+                    child_value >= IBValue(bounds.beta, ABNodeType::PV)) {
+                    return null_window_result;
+                }
+                if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
+                    if (reporter) {
+                        reporter->debug_log(StatReporter::join(
+                            StatReporter::prefix(m_node.get().depth() - 1),
+                            "re-searching with full window\n"));
+                    }
+                }
+            }
+            return negamax<Type, Verbosity, Opts, PVType::PV>(
+                {-bounds.beta, -bounds.alpha}, depth, reporter);
+        } else {
+            (void)n_searched;
+            return negamax<Type, Verbosity, Opts, PV>(
+                {-bounds.beta, -bounds.alpha}, depth, reporter);
+        }
+    }
+
+    //-- Principal variation -------------------------------------------------//
+
+    // Triangular PV table: row n holds the best line from the node at ply n.
+    // Each node clears its row on entry, so when a move becomes best, the
+    // child's row holds its line (empty unless searched as a PV node).
+    constexpr void update_pv(const size_t ply, const move::FatMove mv) {
+        const size_t child_length = m_pv_length[ply + 1];
+        m_pv_table[ply][0] = mv;
+        std::copy_n(m_pv_table[ply + 1].begin(), child_length,
+                    m_pv_table[ply].begin() + 1);
+        m_pv_length[ply] = child_length + 1;
+    }
+
+    //-- Late move reductions ------------------------------------------------//
+
+    // Quiet moves late in the order are searched to a reduced depth,
+    // roughly ln(depth) * ln(moves searched) / 2 plies.
+    // Reduced less at PV nodes, in check, for checks and for killers.
+    static constexpr size_t lmr_min_depth = 3;
+    static constexpr size_t lmr_table_size = 64;
+    static constexpr double lmr_divisor = 2.0;
+
+    using LMRTable =
+        std::array<std::array<depth_t, lmr_table_size>, lmr_table_size>;
+    static constexpr LMRTable lmr_table = [] {
+        LMRTable ret{};
+        for (size_t d = 1; d < lmr_table_size; d++) {
+            for (size_t n = 1; n < lmr_table_size; n++) {
+                ret[d][n] = static_cast<depth_t>(
+                    one_ply * constexpr_ln(static_cast<double>(d)) *
+                    constexpr_ln(static_cast<double>(n)) / lmr_divisor);
+            }
+        }
+        return ret;
+    }();
+
+    // Assumes the move has been made.
+    template <PVType PV>
+    constexpr depth_t late_move_reduction(const move::FatMove mv,
+                                          const depth_t depth,
+                                          const size_t n_searched,
+                                          const bool in_check,
+                                          const bool killer) const {
+        const move::MoveType type = mv.get_move().type();
+        if (depth < static_cast<depth_t>(lmr_min_depth) * one_ply ||
+            move::is_capture(type) || move::is_promotion(type)) {
+            return 0;
+        }
+
+        depth_t ret =
+            lmr_table[std::min(static_cast<size_t>(depth / one_ply),
+                               lmr_table_size - 1)]
+                     [std::min(n_searched, lmr_table_size - 1)];
+        ret -= static_cast<depth_t>(PV == PVType::PV) * one_ply;
+        ret -= static_cast<depth_t>(in_check) * one_ply;
+        ret -= static_cast<depth_t>(m_node.get().is_checked()) * one_ply;
+        ret -= static_cast<depth_t>(killer) * one_ply;
+
+        // Always leave at least one ply
+        return std::clamp(ret, 0, depth - (2 * one_ply));
+    }
+
+    //-- Internal iterative reduction ----------------------------------------//
+
+    // Nodes deep enough to be costly, but with no hash move to search first,
+    // are searched a ply shallower: ordering would be poor anyway, and the
+    // shallower search leaves a hash move for the next iteration.
+    static constexpr size_t iir_min_depth = 4;
+    static constexpr depth_t iir_reduction = one_ply;
+
+    constexpr static bool iir_allowed(const size_t depth_remaining,
+                                      const move::FatMove hash_move,
+                                      const move::FatMove excluded_move,
+                                      const size_t ply) {
+        return ply > 0 && depth_remaining >= iir_min_depth &&
+               hash_move.is_null() && excluded_move.is_null();
+    }
+
+    //-- Forward pruning -----------------------------------------------------//
+
+    // Static evaluations along the current line, by ply.
+    // A node is improving if its static evaluation is better than two plies
+    // earlier (or if that node was in check), so less is pruned.
+    static constexpr eval::centipawn_t no_static_eval =
+        std::numeric_limits<eval::centipawn_t>::min();
+
+    constexpr bool is_improving(const size_t ply) const {
+        const eval::centipawn_t static_eval = m_static_eval[ply];
+        return static_eval != no_static_eval &&
+               (ply < 2 || static_eval > m_static_eval[ply - 2]);
+    }
+
+    // Reverse futility (static null move) pruning:
+    // near the horizon, assume a node fails high if its static evaluation
+    // beats beta by a margin per ply.
+    static constexpr size_t reverse_futility_max_depth = 8;
+    static constexpr eval::centipawn_t reverse_futility_margin = 80;
+
+    constexpr static bool reverse_futile(const Bounds bounds,
+                                         const size_t depth_remaining,
+                                         const eval::centipawn_t static_eval,
+                                         const bool improving) {
+        return depth_remaining <= reverse_futility_max_depth &&
+               !eval::is_mate(bounds.beta) &&
+               static_eval - (reverse_futility_margin *
+                              static_cast<eval::centipawn_t>(
+                                  depth_remaining - improving)) >=
+                   bounds.beta;
+    }
+
+    // Razoring: near the horizon, if the static evaluation is far below alpha,
+    // search captures (and checks) only, and fail low if they do.
+    static constexpr size_t razoring_max_depth = 3;
+    static constexpr eval::centipawn_t razoring_margin = 200;
+
+    // Futility pruning: near the horizon, skip quiet moves if the static
+    // evaluation is below alpha by a margin per ply.
+    static constexpr size_t futility_max_depth = 6;
+    static constexpr eval::centipawn_t futility_base_margin = 100;
+    static constexpr eval::centipawn_t futility_margin_per_ply = 100;
+
+    constexpr static eval::centipawn_t futility_margin(
+        const size_t depth_remaining) {
+        return futility_base_margin +
+               (futility_margin_per_ply *
+                static_cast<eval::centipawn_t>(depth_remaining));
+    }
+
+    // Delta pruning: in quiescence, skip captures which cannot raise the
+    // stand-pat score to alpha, even with a margin for positional gains.
+    static constexpr eval::centipawn_t delta_margin = 200;
+
+    constexpr bool delta_prunable(const Bounds bounds,
+                                  const eval::centipawn_t standpat_score,
+                                  const move::FatMove mv) const {
+        return standpat_score != no_static_eval &&
+               move::is_capture(mv.get_move().type()) &&
+               standpat_score +
+                       StaticExchange::material_gain(
+                           m_node.get().get_astate(), mv) +
+                       delta_margin <=
+                   bounds.alpha;
+    }
+
+    // Late move (move count) pruning: near the horizon, skip quiet moves
+    // after a number of moves growing quadratically with depth.
+    static constexpr size_t lmp_max_depth = 8;
+    static constexpr size_t lmp_base_count = 3;
+
+    constexpr static size_t lmp_move_count(const size_t depth_remaining,
+                                           const bool improving) {
+        return (lmp_base_count + (depth_remaining * depth_remaining)) /
+               (improving ? 1 : 2);
     }
 
+    //-- Extensions ----------------------------------------------------------//
+
+    // Moves are searched deeper if they give check (without losing material),
+    // recapture, or are singular (a hash move much better than all
+    // alternatives).
+    // Extensions are only made within twice the root depth, and by at most
+    // one ply per move, so lines cannot grow without bound.
+    static constexpr depth_t check_extension = one_ply;
+    static constexpr depth_t recapture_extension = one_ply / 2;
+    static constexpr depth_t singular_extension = one_ply;
+    static constexpr depth_t max_extension = one_ply;
+
     template <NegaMaxOptions Opts>
-    constexpr SearchResult search(Bounds bounds = {},
-                                  const StatReporter *reporter = nullptr) {
-        return search<SearchType::NORMAL, VerbosityLevel::QUIET, Opts>(
-            bounds, reporter);
+    constexpr depth_t move_extension(const move::FatMove mv,
+                                     const move::FatMove prev_move,
+                                     const bool safe_check,
+                                     const bool singular) const {
+        depth_t ret = 0;
+        if constexpr (Opts.check_extensions) {
+            if (safe_check) {
+                ret += check_extension;
+            }
+        }
+        if constexpr (Opts.recapture_extensions) {
+            if (move::is_capture(mv.get_move().type()) &&
+                move::is_capture(prev_move.get_move().type()) &&
+                mv.get_move().to() == prev_move.get_move().to()) {
+                ret += recapture_extension;
+            }
+        }
+        if constexpr (Opts.singular_extensions) {
+            if (singular) {
+                ret += singular_extension;
+            }
+        }
+        return std::min(ret, max_extension);
     }
 
-    // Extracts principal variation from the transposition table.
-    void get_pv(MoveBuffer &buf) {
-        return m_ttable.get().get_pv(buf, m_node.get());
+    // The hash move is singular if, with it excluded, a reduced search of the
+    // node fails low against the hash value less a margin per ply.
+    // If instead it fails high, and the margin is still above beta,
+    // several moves likely fail high: the node is cut (multi-cut).
+    static constexpr size_t singular_min_depth = 6;
+    static constexpr size_t singular_tt_depth_margin = 3;
+
+    // Requires a lower bound from the table, not much shallower than this node.
+    constexpr bool singular_allowed(
+        const size_t depth_remaining, const move::FatMove hash_move,
+        const std::optional<TTable::TTValue> &tt_value) const {
+        return m_node.get().depth() > 0 &&
+               depth_remaining >= singular_min_depth && !hash_move.is_null() &&
+               tt_value.has_value() &&
+               tt_value->value.node_type() != ABNodeType::ALL &&
+               tt_value->depth_remaining + singular_tt_depth_margin >=
+                   depth_remaining &&
+               !eval::is_mate(tt_value->value.eval());
     }
 
-   private:
-    // Return value in (soft/hard) cutoff
-    constexpr SearchResult cutoff_result() const {
-        return {.value = IBValue(m_node.get().template get<TEval>().eval(),
-                                 ABNodeType::PV),
-                .type = SearchResult::LeafType::DEPTH_CUTOFF};
+    // Searches the node without the hash move, with a null window at
+    // singular_beta.
+    template <VerbosityLevel Verbosity, NegaMaxOptions Opts>
+    constexpr SearchResult excluded_search(
+        const depth_t depth, const move::FatMove hash_move,
+        const eval::centipawn_t singular_beta, const StatReporter *reporter) {
+        const size_t ply = m_node.get().depth();
+        m_excluded[ply] = hash_move;
+        const SearchResult result =
+            negamax<SearchType::NORMAL, Verbosity, Opts, PVType::NON_PV>(
+                {singular_beta - 1, singular_beta}, (depth - one_ply) / 2,
+                reporter);
+        m_excluded[ply] = {};
+        return result;
+    }
+
+    //-- ProbCut -------------------------------------------------------------//
+
+    // If a capture which does not lose material fails high against beta plus
+    // a margin, first in quiescence, then in a search reduced by a few plies,
+    // assume the node fails high.
+    static constexpr size_t probcut_min_depth = 5;
+    static constexpr size_t probcut_reduction = 4;
+    static constexpr size_t probcut_tt_depth_margin = 3;
+
+    // Not if the table already suggests the reduced search will fail low.
+    constexpr bool probcut_allowed(
+        const Bounds bounds, const depth_t depth,
+        const std::optional<TTable::TTValue> &tt_value) const {
+        const eval::centipawn_t probcut_beta =
+            bounds.beta + m_params.probcut_margin;
+        const size_t depth_remaining = static_cast<size_t>(depth / one_ply);
+        return depth_remaining >= probcut_min_depth &&
+               !eval::is_mate(probcut_beta) &&
+               !(tt_value.has_value() &&
+                 tt_value->depth_remaining + probcut_tt_depth_margin >=
+                     depth_remaining &&
+                 tt_value->value.eval() < probcut_beta);
     }
 
-    // Gets moves to be searched based on search type.
-    template <SearchType Type>
-    constexpr MoveBuffer &search_moves();
+    // Returns the (lower bound) result if some capture fails high.
+    template <VerbosityLevel Verbosity, NegaMaxOptions Opts>
+    constexpr std::optional<SearchResult> probcut_search(
+        const Bounds bounds, const depth_t depth,
+        const move::FatMove hash_move, const StatReporter *reporter) {
+        DefaultNode<TEval, MaxDepth> &node = m_node.get();
+        const eval::centipawn_t probcut_beta =
+            bounds.beta + m_params.probcut_margin;
+        const Bounds child_bounds = {-probcut_beta, -probcut_beta + 1};
+        const IBValue probcut_value(probcut_beta, ABNodeType::PV);
+
+        MovePicker<SearchType::QUIESCE, Opts.sort, DefaultNode<TEval, MaxDepth>,
+                   MoveGenerator<Opts>>
+            picker(m_node, hash_move);
+        while (const std::optional<move::FatMove> next_move = picker.next()) {
+            const move::FatMove m = next_move.value();
+            if (is_stopped()) {
+                return {{.type = SearchResult::LeafType::TIMEOUT}};
+            }
+            if (StaticExchange::see(node.get_astate(), m) < 0) {
+                continue;
+            }
+
+            std::optional<SearchResult> result;
+            if (node.make_move(m)) {
+                result =
+                    negamax<SearchType::QUIESCE, Verbosity, Opts,
+                            PVType::NON_PV>(child_bounds, 0, reporter);
+                if (result->type != SearchResult::LeafType::TIMEOUT &&
+                    -result->value >= probcut_value) {
+                    result = negamax<SearchType::NORMAL, Verbosity, Opts,
+                                     PVType::NON_PV>(
+                        child_bounds,
+                        depth - static_cast<depth_t>(probcut_reduction *
+                                                     one_ply),
+                        reporter);
+                }
+            }
+            node.unmake_move();
 
-    template <>
-    constexpr MoveBuffer &search_moves<SearchType::NORMAL>() {
-        return m_node.get().template find_moves<true>();
+            if (!result.has_value()) {
+                continue;
+            }
+            if (result->type == SearchResult::LeafType::TIMEOUT) {
+                return result;
+            }
+            if (-result->value >= probcut_value) {
+                const SearchResult ret = {
+                    .value = IBValue(-result->value.eval(), ABNodeType::CUT),
+                    .type = SearchResult::LeafType::DEPTH_CUTOFF,
+                    .best_move = m};
+                m_ttable.get().insert(
+                    node.template get<Zobrist>(), ret,
+                    static_cast<uint8_t>((depth / one_ply) -
+                                         probcut_tt_depth_margin),
+                    node.depth());
+                if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
+                    if (reporter) {
+                        reporter->debug_log(StatReporter::join(
+                            StatReporter::prefix(node.depth()),
+                            "probcut with move: ", m.pretty(), ", score: ",
+                            std::to_string(ret.value.eval()), " }\n"));
+                    }
+                }
+                return ret;
+            }
+        }
+        return {};
     }
 
-    // Return sorted
-    template <>
-    constexpr MoveBuffer &search_moves<SearchType::QUIESCE>() {
-        return m_node.get().find_loud_moves();
+    //-- Null-move pruning ---------------------------------------------------//
+
+    // If passing the turn still fails high after a reduced search, assume
+    // the node fails high. The reduction grows with the depth remaining.
+    // Deep cutoffs are verified by a reduced search of the node itself,
+    // without null moves for the first few plies.
+    static constexpr size_t null_move_min_depth = 3;
+    static constexpr size_t null_move_base_reduction = 2;
+    static constexpr size_t null_move_depth_divisor = 4;
+    static constexpr size_t null_move_verification_depth = 8;
+
+    // Not in check, or after a null move, or with only pawns left (where
+    // zugzwang is likely), or if a mate score is needed to fail high.
+    constexpr bool null_move_allowed(
+        const Bounds bounds, const depth_t depth, const bool in_check,
+        const eval::centipawn_t static_eval) const {
+        const DefaultNode<TEval, MaxDepth> &node = m_node.get();
+        if (node.depth() == 0 || node.depth() < m_null_move_min_ply ||
+            depth < static_cast<depth_t>(null_move_min_depth) * one_ply ||
+            node.last_move_null() || eval::is_mate(bounds.beta)) {
+            return false;
+        }
+
+        const state::State &state = node.get_astate().state;
+        const board::Colour to_move = state.to_move;
+        const bool only_pawns =
+            (state.copy_bitboard({to_move, board::Piece::KNIGHT}) |
+             state.copy_bitboard({to_move, board::Piece::BISHOP}) |
+             state.copy_bitboard({to_move, board::Piece::ROOK}) |
+             state.copy_bitboard({to_move, board::Piece::QUEEN}))
+                .empty();
+
+        return !only_pawns && !in_check && static_eval >= bounds.beta;
     }
 
-    // Quiescence helper: if no loud moves were found,
-    // check if this is due to checkmate/stalemate,
-    // or if there are legal quiet moves.
-    constexpr bool quiet_moves_exist() {
-        // Get children (in order)
-        const MoveBuffer &moves = m_node.get().find_quiet_moves();
+    // Returns the (lower bound) result if the null move fails high.
+    template <VerbosityLevel Verbosity, NegaMaxOptions Opts>
+    constexpr std::optional<SearchResult> null_move_search(
+        const Bounds bounds, const depth_t depth,
+        const StatReporter *reporter) {
+        DefaultNode<TEval, MaxDepth> &node = m_node.get();
+        const depth_t reduction = std::min(
+            static_cast<depth_t>(null_move_base_reduction +
+                                 (depth / one_ply / null_move_depth_divisor)) *
+                one_ply,
+            depth - one_ply);
 
-        for (const move::FatMove &m : moves) {
-            if (m_node.get().make_move(m)) {
-                m_node.get().unmake_move();
-                return true;
+        if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
+            if (reporter) {
+                reporter->debug_log(StatReporter::join(
+                    StatReporter::prefix(node.depth()),
+                    "searching null move {\n"));
             }
-            m_node.get().unmake_move();
         }
 
-        return false;
+        node.make_null_move();
+        const SearchResult null_result =
+            negamax<SearchType::NORMAL, Verbosity, Opts, PVType::NON_PV>(
+                {-bounds.beta, -bounds.beta + 1}, depth - one_ply - reduction,
+                reporter);
+        node.unmake_null_move();
+
+        if (null_result.type == SearchResult::LeafType::TIMEOUT) {
+            return null_result;
+        }
+
+        eval::centipawn_t null_score = -null_result.value.eval();
+        if (null_score < bounds.beta) {
+            return {};
+        }
+
+        // Unproven mates are not returned
+        if (eval::is_mate(null_score)) {
+            null_score = bounds.beta;
+        }
+
+        // Verify deep cutoffs
+        if (depth >= static_cast<depth_t>(null_move_verification_depth) *
+                         one_ply) {
+            const size_t prev_min_ply = m_null_move_min_ply;
+            m_null_move_min_ply =
+                node.depth() +
+                static_cast<size_t>((3 * (depth - reduction)) / (4 * one_ply));
+            const SearchResult verification_result =
+                negamax<SearchType::NORMAL, Verbosity, Opts, PVType::NON_PV>(
+                    {bounds.beta - 1, bounds.beta}, depth - reduction,
+                    reporter);
+            m_null_move_min_ply = prev_min_ply;
+
+            if (verification_result.type == SearchResult::LeafType::TIMEOUT) {
+                return verification_result;
+            }
+            if (verification_result.value.eval() < bounds.beta) {
+                return {};
+            }
+        }
+
+        if constexpr (Verbosity == VerbosityLevel::VERBOSE) {
+            if (reporter) {
+                reporter->debug_log(StatReporter::join(
+                    StatReporter::prefix(node.depth()),
+                    "null move failed high, score: ",
+                    std::to_string(null_score), " }\n"));
+            }
+        }
+
+        return {{.value = IBValue(null_score, ABNodeType::CUT),
+                 .type = SearchResult::LeafType::DEPTH_CUTOFF,
+                 .best_move = {}}};
+    }
+
+    // Only the searching thread writes the count, so it need not be a
+    // read-modify-write.
+    constexpr void count_nodes(const ptrdiff_t n) {
+        m_node_count.store(m_node_count.load(std::memory_order::relaxed) + n,
+                           std::memory_order::relaxed);
+    }
+
+    // Return value in (soft/hard) cutoff
+    constexpr SearchResult cutoff_result() const {
+        return {.value = IBValue(m_node.get().template get<TEval>().eval(),
+                                 ABNodeType::PV),
+                .type = SearchResult::LeafType::DEPTH_CUTOFF};
     }
 
     // Helper for fifty-move rule: check a legal move exists.
@@ -822,16 +2324,36 @@ class DLNegaMax {
 
     std::atomic<bool> m_stopped = false;
 
-    size_t m_node_count = 0;
+    std::atomic<size_t> m_node_count = 0;
 
     // Accessible to other threads
-    std::atomic<
-        std::optional<std::chrono::time_point<std::chrono::steady_clock>>>
-        m_finish_time;
+    std::optional<size_t> m_node_limit;
+
+    size_t m_nodes_since_limit_check = 0;
+    size_t m_best_move_nodes = 0;
+    size_t m_root_nodes = 0;
+
+    // Depth of the next search, in plies.
+    size_t m_depth = 0;
+
+    // Null moves are not tried above this ply (during verification).
+    size_t m_null_move_min_ply = 0;
+
+    OrderingTables<MaxDepth> m_ordering;
+    static constexpr size_t max_tracked_quiets = 64;
 
-    size_t m_nodes_since_time_check = 0;
+    // One row per ply, including the bottomed out ply (always empty)
+    std::array<std::array<move::FatMove, MaxDepth>, MaxDepth + 1> m_pv_table;
+    std::array<size_t, MaxDepth + 1> m_pv_length{};
 
-    static constexpr size_t time_check_freq = 100;
+    std::array<eval::centipawn_t, MaxDepth + 1> m_static_eval{};
+
+    std::array<move::FatMove, MaxDepth + 1> m_excluded{};
+    MoveBuffer m_root_moves;
+
+    SearchParams m_params{};
+
+    static constexpr size_t limit_check_freq = 100;
 };
 static_assert(DLSearcher<DLNegaMax<eval::StdEval, 1>>);
 
@@ -842,7 +2364,10 @@ static_assert(DLSearcher<DLNegaMax<eval::StdEval, 1>>);
 // Given a depth-limited searcher, implement iterative deepening
 // No special move ordering
 // Synchronises stop/search w/ mutex.
-template <DLSearcher TSearcher, size_t MaxDepth>
+// Stops between iterations when the time manager says so (set up by the
+// caller with start(), which should also stop the search at its hard limit).
+template <DLSearcher TSearcher, size_t MaxDepth,
+          DynamicTimeManager TTimeManager = DefaultDynamicTimeManager>
 class IDSearcher {
    public:
     template <typename... Ts>
@@ -851,24 +2376,61 @@ class IDSearcher {
 
     // Stops the search as soon as possible, will return to the (other)
     // thread which called search().
+    // Blocks until the first ply completes, so a move is always found.
     constexpr void stop() {
-        m_stopped = true;
+        const std::lock_guard<std::mutex> lock(m_stoplock);
+        m_stopped.store(true, std::memory_order::relaxed);
         m_searcher.stop();
     };
+    constexpr bool is_stopped() const {
+        return m_stopped.load(std::memory_order::relaxed);
+    }
 
-    constexpr void set_finish_time(
-        const std::optional<std::chrono::time_point<std::chrono::steady_clock>>
-            finish_time) {
-        m_searcher.set_finish_time(finish_time);
+    constexpr void set_params(const SearchParams &params) {
+        m_searcher.set_params(params);
     }
 
-    constexpr std::optional<std::chrono::time_point<std::chrono::steady_clock>>
-    get_finish_time() const {
-        return m_searcher.get_finish_time();
+    constexpr const SearchParams &get_params() const {
+        return m_searcher.get_params();
     }
 
     constexpr const MoveBuffer &get_pv() const { return m_pv; }
 
+    // Number of principal variations (best moves) to search and report.
+    // Must not be called during search.
+    constexpr void set_multipv(const size_t multipv) {
+        assert(multipv > 0);
+        m_multipv = multipv;
+    }
+
+    constexpr size_t get_multipv() const { return m_multipv; }
+
+    // Search limits other than depth and time, none if empty:
+    // * nodes searched (by this thread) over all iterations,
+    // * a mate for the side to move within a number of moves,
+    // * root moves searched (ignored if none are legal).
+    // Must not be called during search.
+    constexpr void set_node_limit(const std::optional<size_t> node_limit) {
+        m_node_limit = node_limit;
+    }
+
+    constexpr void set_mate_limit(const std::optional<size_t> mate_limit) {
+        m_mate_limit = mate_limit;
+    }
+
+    constexpr void set_search_moves(const MoveBuffer &search_moves) {
+        m_search_moves = search_moves;
+    }
+
+    constexpr const MoveBuffer &get_search_moves() const {
+        return m_search_moves;
+    }
+
+    constexpr TTimeManager &get_time_manager() { return m_time_manager; }
+
+    // Depth of the last completed iteration.
+    constexpr size_t get_depth_reached() const { return m_depth_reached; }
+
     // Infer return type from searcher,
     // Always searches at least to depth 1 so a legal move is returned.
     template <VerbosityLevel Verbosity = VerbosityLevel::QUIET>
@@ -876,28 +2438,46 @@ class IDSearcher {
                           const StatReporter *reporter = nullptr,
                           size_t start_depth = 1) {
         m_stoplock.lock();
-        m_stopped = false;
+        m_stopped.store(false, std::memory_order::relaxed);
         m_stoplock.unlock();
 
         std::optional<SearchResult> search_result = {};
+        m_depth_reached = 0;
+
+        if constexpr (requires { m_searcher.new_search(); }) {
+            m_searcher.new_search();
+        }
+
+        // Root moves are listed (and sorted between iterations) only if
+        // searched more than once per iteration or restricted.
+        m_lines.clear();
+        m_root_moves.clear();
+        if (m_multipv > 1 || m_search_moves.size() > 0) {
+            m_searcher.find_root_moves(m_root_moves);
+            filter_root_moves();
+        }
+        const bool root_listed = m_root_moves.size() > 0;
+        size_t nodes_searched = 0;
 
         // TODO: print warning
         if (start_depth > m_depth) {
             start_depth = m_depth;
         }
 
-        std::optional<std::chrono::time_point<std::chrono::steady_clock>>
-            searcher_finish_time = get_finish_time();
-
         // Loop over all possible levels
-        for (size_t max_depth = start_depth; max_depth <= m_depth && !m_stopped;
-             max_depth++) {
+        for (size_t max_depth = start_depth;
+             max_depth <= m_depth && !is_stopped(); max_depth++) {
+            if (max_depth > 1 && m_node_limit.has_value() &&
+                nodes_searched >= m_node_limit.value()) {
+                break;
+            }
+
             // Time/node count for reporting
             auto start_time = std::chrono::steady_clock::now();
 
             m_stoplock.lock();
             // Force the first ply to complete
-            if (!m_stopped || max_depth == 1) {
+            if (!is_stopped() || max_depth == 1) {
                 m_searcher.set_depth(max_depth);
             } else {
                 // Will be reached if search was aborted before first ply,
@@ -910,46 +2490,93 @@ class IDSearcher {
                 m_stoplock.unlock();
             }
 
-            // don't exit on time in the first ply
-            if (max_depth == 1) {
-                m_searcher.set_finish_time({});
-            } else if (max_depth == 2) {
-                m_searcher.set_finish_time(searcher_finish_time);
-            }
+            // don't exit on nodes in the first ply
+            m_searcher.set_node_limit(
+                max_depth == 1
+                    ? std::nullopt
+                    : m_node_limit.transform(
+                          [nodes_searched](const size_t limit) {
+                              return limit - nodes_searched;
+                          }));
 
             SearchResult candidate_result =
-                m_searcher.template search<SearchType::NORMAL, Verbosity>(
-                    bounds, reporter);
+                root_listed
+                    ? multipv_search<Verbosity>(max_depth, bounds, reporter,
+                                                start_time)
+                    : aspiration_search<Verbosity>(max_depth, bounds,
+                                                   search_result, 1, reporter,
+                                                   start_time);
 
             // if first ply, we now have a result
             if (max_depth == 1) {
                 m_stoplock.unlock();
             }
+            nodes_searched += m_searcher.get_node_count();
 
             if (candidate_result.type == SearchResult::LeafType::TIMEOUT) {
                 break;
             };
 
             search_result = {candidate_result};
+            m_depth_reached = max_depth;
 
             // Report partial results
 
             assert(search_result.has_value());
 
-            m_searcher.get_pv(m_pv);
+            if (root_listed) {
+                m_pv = m_lines[0].pv;
+            } else {
+                m_searcher.get_pv(m_pv);
+            }
 
             const std::chrono::duration<double> elapsed =
                 std::chrono::steady_clock::now() - start_time;
 
             // TODO: report nps for current iteration, not total?
             if (reporter) {
-                reporter->report(max_depth, search_result->value.eval(),
-                                 m_searcher.get_node_count(), elapsed, m_pv);
+                if (root_listed) {
+                    for (size_t i = 0; i < m_lines.size(); i++) {
+                        reporter->report(max_depth, i + 1,
+                                         m_lines[i].result.value.eval(),
+                                         ABNodeType::PV,
+                                         m_searcher.get_node_count(), elapsed,
+                                         m_lines[i].pv);
+                    }
+                } else {
+                    reporter->report(max_depth, 1, search_result->value.eval(),
+                                     ABNodeType::PV,
+                                     m_searcher.get_node_count(), elapsed,
+                                     m_pv);
+                }
             }
 
             if (search_result->type == SearchResult::LeafType::CHECKMATE) {
                 break;
             }
+
+            m_time_manager.update(
+                {.best_move = search_result->best_move,
+                 .eval = search_result->value.eval(),
+                 .nodes = root_listed ? m_lines[0].root_nodes
+                                      : m_searcher.get_root_nodes(),
+                 .best_move_nodes = root_listed
+                                        ? m_lines[0].best_move_nodes
+                                        : m_searcher.get_best_move_nodes(),
+                 .time = elapsed});
+            if (m_time_manager.should_stop()) {
+                break;
+            }
+
+            // Mate found within the limit
+            if (m_mate_limit.has_value()) {
+                const eval::centipawn_t score = search_result->value.eval();
+                if (eval::is_mate(score) && eval::mate_in(score) > 0 &&
+                    static_cast<size_t>(eval::mate_in(score)) <=
+                        m_mate_limit.value()) {
+                    break;
+                }
+            }
         };
 
         assert(search_result.has_value());
@@ -962,16 +2589,182 @@ class IDSearcher {
     };
 
    private:
+    // Aspiration windows: from a minimum depth, search a window around the
+    // previous score. On failure, report the bound, widen the failing side
+    // (eventually to the caller's bound) and re-search.
+    static constexpr size_t aspiration_min_depth = 4;
+    static constexpr eval::centipawn_t aspiration_delta = 25;
+    static constexpr eval::centipawn_t aspiration_max_delta = 1000;
+
+    template <VerbosityLevel Verbosity>
+    SearchResult aspiration_search(
+        const size_t depth, const Bounds bounds,
+        const std::optional<SearchResult> &prev, const size_t line,
+        const StatReporter *reporter,
+        const std::chrono::time_point<std::chrono::steady_clock> start_time) {
+        // No window for mate scores
+        if (depth < aspiration_min_depth || !prev.has_value() ||
+            eval::is_mate(prev->value.eval())) {
+            return m_searcher.template search<SearchType::NORMAL, Verbosity>(
+                bounds, reporter);
+        }
+
+        const eval::centipawn_t prev_score = prev->value.eval();
+        eval::centipawn_t alpha_delta = aspiration_delta;
+        eval::centipawn_t beta_delta = aspiration_delta;
+        Bounds window{std::max(bounds.alpha, prev_score - alpha_delta),
+                      std::min(bounds.beta, prev_score + beta_delta)};
+
+        while (true) {
+            const SearchResult result =
+                m_searcher.template search<SearchType::NORMAL, Verbosity>(
+                    window, reporter);
+            if (result.type == SearchResult::LeafType::TIMEOUT) {
+                return result;
+            }
+
+            const eval::centipawn_t score = result.value.eval();
+            ABNodeType bound = ABNodeType::PV;
+            if (score <= window.alpha && window.alpha > bounds.alpha) {
+                bound = ABNodeType::ALL;
+                alpha_delta *= 2;
+                window.alpha =
+                    alpha_delta > aspiration_max_delta
+                        ? bounds.alpha
+                        : std::max(bounds.alpha, score - alpha_delta);
+            } else if (score >= window.beta && window.beta < bounds.beta) {
+                bound = ABNodeType::CUT;
+                beta_delta *= 2;
+                window.beta = beta_delta > aspiration_max_delta
+                                  ? bounds.beta
+                                  : std::min(bounds.beta, score + beta_delta);
+            } else {
+                return result;
+            }
+
+            if (reporter) {
+                m_searcher.get_pv(m_pv);
+                const std::chrono::duration<double> elapsed =
+                    std::chrono::steady_clock::now() - start_time;
+                reporter->report(depth, line, score, bound,
+                                 m_searcher.get_node_count(), elapsed, m_pv);
+            }
+        }
+    }
+
+    // MultiPV: each iteration searches the root once per line, excluding the
+    // moves of earlier lines, each with an aspiration window around the
+    // line's previous score.
+    // Lines share the transposition table, and root moves are kept sorted
+    // by score between iterations, so later lines are cheap.
+    struct Line {
+        SearchResult result;
+        MoveBuffer pv;
+        size_t root_nodes;
+        size_t best_move_nodes;
+    };
+
+    template <VerbosityLevel Verbosity>
+    SearchResult multipv_search(
+        const size_t depth, const Bounds bounds, const StatReporter *reporter,
+        const std::chrono::time_point<std::chrono::steady_clock> start_time) {
+        // Mated or stalemated: the root is searched as a leaf
+        if (m_root_moves.size() == 0) {
+            m_lines.clear();
+            return m_searcher.template search<SearchType::NORMAL, Verbosity>(
+                bounds, reporter);
+        }
+
+        std::vector<Line> lines;
+        MoveBuffer remaining = m_root_moves;
+
+        while (lines.size() < m_multipv && remaining.size() > 0) {
+            m_searcher.set_root_moves(remaining);
+            const std::optional<SearchResult> prev =
+                lines.size() < m_lines.size()
+                    ? std::optional(m_lines[lines.size()].result)
+                    : std::nullopt;
+            const SearchResult result = aspiration_search<Verbosity>(
+                depth, bounds, prev, lines.size() + 1, reporter, start_time);
+            if (result.type == SearchResult::LeafType::TIMEOUT) {
+                m_searcher.set_root_moves({});
+                return result;
+            }
+
+            lines.push_back(
+                {.result = result,
+                 .pv = {},
+                 .root_nodes = m_searcher.get_root_nodes(),
+                 .best_move_nodes = m_searcher.get_best_move_nodes()});
+            m_searcher.get_pv(lines.back().pv);
+            erase_move(remaining, result.best_move);
+        }
+        m_searcher.set_root_moves({});
+
+        // Lines by score, then the remaining moves in their previous order
+        std::stable_sort(lines.begin(), lines.end(),
+                         [](const Line &a, const Line &b) {
+                             return a.result.value.eval() >
+                                    b.result.value.eval();
+                         });
+        m_root_moves.clear();
+        for (const Line &line : lines) {
+            m_root_moves.push_back(line.result.best_move);
+        }
+        for (const move::FatMove m : remaining) {
+            m_root_moves.push_back(m);
+        }
+
+        m_lines = std::move(lines);
+        return m_lines[0].result;
+    }
+
+    // Restricts the root moves to the search moves, if any are legal.
+    constexpr void filter_root_moves() {
+        MoveBuffer filtered;
+        for (const move::FatMove m : m_root_moves) {
+            if (std::find(m_search_moves.begin(), m_search_moves.end(), m) !=
+                m_search_moves.end()) {
+                filtered.push_back(m);
+            }
+        }
+        if (filtered.size() > 0) {
+            m_root_moves = filtered;
+        }
+    }
+
+    // Removes a move from a buffer, preserving order.
+    static constexpr void erase_move(MoveBuffer &moves,
+                                          const move::FatMove mv) {
+        size_t j = 0;
+        for (size_t i = 0; i < moves.size(); i++) {
+            if (moves[i] != mv) {
+                moves[j++] = moves[i];
+            }
+        }
+        moves.resize(j);
+    }
+
     // Searcher should be shorter-lived than other objects.
     TSearcher m_searcher;
     size_t m_depth = MaxDepth;
+    size_t m_depth_reached = 0;
 
     std::atomic<bool> m_stopped = false;
     std::mutex m_stoplock;
 
-    // For now, just report one move from pv
-    // TODO: triangular table
+    // Principal variation of the last completed iteration
     MoveBuffer m_pv;
+
+    size_t m_multipv = 1;
+    std::vector<Line> m_lines;
+    MoveBuffer m_root_moves;
+
+    std::optional<size_t> m_node_limit;
+    std::optional<size_t> m_mate_limit;
+    MoveBuffer m_search_moves;
+
+    TTimeManager m_time_manager{};
 };
 
 constexpr static size_t default_max_depth = 64;
@@ -982,4 +2775,299 @@ using DefaultSearcher =
 static_assert(StoppableSearcher<DefaultSearcher>);
 static_assert(DLSearcher<DefaultSearcher>);
 
+//============================================================================//
+// Parallel search
+//============================================================================//
+
+// Lazy SMP: helper threads search the same root to increasing depth, sharing
+// only the transposition table.
+// Every other helper starts a ply deeper, so that threads desynchronise and
+// fill the table with entries the main thread will soon need.
+// The main thread runs an IDSearcher, whose reports include helper nodes.
+template <eval::IncrementallyUpdateableEvaluator TEval, size_t MaxDepth>
+class LazySMPSearcher {
+   public:
+    using Node = DefaultNode<TEval, MaxDepth>;
+
+    LazySMPSearcher(Node &node, TTable &ttable)
+        : m_node(node), m_ttable(ttable), m_main(node, ttable) {}
+
+    LazySMPSearcher(const LazySMPSearcher &) = delete;
+    LazySMPSearcher(LazySMPSearcher &&) = delete;
+    LazySMPSearcher &operator=(const LazySMPSearcher &) = delete;
+    LazySMPSearcher &operator=(LazySMPSearcher &&) = delete;
+    ~LazySMPSearcher() = default;
+
+    // Sets the number of threads, including the main thread.
+    // Must not be called during search.
+    void set_threads(const size_t n_threads) {
+        assert(n_threads > 0);
+        while (m_helpers.size() + 1 > n_threads) {
+            m_helpers.pop_back();
+        }
+        while (m_helpers.size() + 1 < n_threads) {
+            m_helpers.push_back(std::make_unique<Helper>(m_ttable));
+        }
+    }
+
+    size_t get_threads() const { return m_helpers.size() + 1; }
+
+    void stop() {
+        stop_helpers();
+        m_main.stop();
+    }
+
+    void set_depth(const size_t depth) {
+        assert(depth <= MaxDepth);
+        m_depth = depth;
+        m_main.set_depth(depth);
+    }
+
+    // Must not be called during search.
+    void set_params(const SearchParams &params) {
+        m_params = params;
+        m_main.set_params(params);
+    }
+
+    const SearchParams &get_params() const { return m_params; }
+
+    // Must not be called during search.
+    void set_multipv(const size_t multipv) { m_main.set_multipv(multipv); }
+    size_t get_multipv() const { return m_main.get_multipv(); }
+
+    // Limits apply to the main thread, which stops the helpers.
+    // Must not be called during search.
+    void set_node_limit(const std::optional<size_t> node_limit) {
+        m_main.set_node_limit(node_limit);
+    }
+
+    void set_mate_limit(const std::optional<size_t> mate_limit) {
+        m_main.set_mate_limit(mate_limit);
+    }
+
+    void set_search_moves(const MoveBuffer &search_moves) {
+        m_main.set_search_moves(search_moves);
+    }
+
+    // Consulted by the main thread only.
+    auto &get_time_manager() { return m_main.get_time_manager(); }
+
+    const MoveBuffer &get_pv() const { return m_pv; }
+
+    // Searches on all threads until the main thread returns,
+    // then returns the result of the deepest completed iteration.
+    template <VerbosityLevel Verbosity = VerbosityLevel::QUIET>
+    SearchResult search(Bounds bounds = {},
+                        const StatReporter *reporter = nullptr,
+                        size_t start_depth = 1) {
+        start_depth = std::min(start_depth, m_depth);
+        m_ttable.get().new_search();
+
+        // Helpers search a single line over every root move, so are not
+        // started if the root is restricted or searched for several lines.
+        const bool root_listed = m_main.get_search_moves().size() > 0 ||
+                                 m_main.get_multipv() > 1;
+        if (root_listed) {
+            // Nothing to report from the helpers
+            for (const std::unique_ptr<Helper> &helper : m_helpers) {
+                helper->nodes = 0;
+            }
+        } else {
+            start_helpers(bounds, start_depth);
+        }
+
+        const SMPReporter smp_reporter{reporter, *this};
+        SearchResult ret = m_main.template search<Verbosity>(
+            bounds, reporter ? &smp_reporter : nullptr, start_depth);
+        m_pv = m_main.get_pv();
+        if (root_listed) {
+            return ret;
+        }
+
+        stop_helpers();
+        for (const std::unique_ptr<Helper> &helper : m_helpers) {
+            helper->thread.join();
+        }
+
+        size_t depth_reached = m_main.get_depth_reached();
+        for (const std::unique_ptr<Helper> &helper : m_helpers) {
+            if (helper->result && helper->depth_reached > depth_reached) {
+                depth_reached = helper->depth_reached;
+                ret = helper->result.value();
+                m_pv = helper->pv;
+            }
+        }
+
+        return ret;
+    }
+
+   private:
+    // Each helper owns its state and node (and so move buffers),
+    // but shares the transposition table.
+    struct Helper {
+        Helper(TTable &ttable)
+            : node(astate, MaxDepth), searcher(node, ttable) {}
+
+        state::AugmentedState astate{};
+        Node node;
+        DLNegaMax<TEval, MaxDepth> searcher;
+        std::thread thread;
+
+        // Guarded by m_stoplock during search
+        size_t nodes = 0;
+        bool searching = false;
+
+        // Last completed iteration, read once joined
+        std::optional<SearchResult> result;
+        size_t depth_reached = 0;
+        MoveBuffer pv;
+    };
+
+    // Forwards the main thread's reports, with nodes searched on all threads
+    // and the time since search started.
+    // The main thread reports nodes and time of its current iteration, so its
+    // earlier iterations are added as its depth changes.
+    class SMPReporter : public StatReporter {
+       public:
+        SMPReporter(const StatReporter *reporter, LazySMPSearcher &searcher)
+            : m_reporter(reporter),
+              m_searcher(searcher),
+              m_start_time(std::chrono::steady_clock::now()) {}
+
+        void report(const size_t depth, const size_t line,
+                    const eval::centipawn_t eval, const ABNodeType bound,
+                    const size_t nodes,
+                    const std::chrono::duration<double> time,
+                    const MoveBuffer &pv) const override {
+            (void)time;
+            if (depth != m_last_depth) {
+                m_main_nodes += m_last_nodes;
+                m_last_depth = depth;
+            }
+            m_last_nodes = nodes;
+
+            const std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - m_start_time;
+            m_reporter->report(
+                depth, line, eval, bound,
+                m_main_nodes + nodes + m_searcher.get().helper_node_count(),
+                elapsed, pv);
+        }
+
+        void debug_log(const std::string_view &msg) const override {
+            m_reporter->debug_log(msg);
+        }
+
+       private:
+        const StatReporter *m_reporter;
+        std::reference_wrapper<LazySMPSearcher> m_searcher;
+        std::chrono::time_point<std::chrono::steady_clock> m_start_time;
+
+        // Main thread nodes in completed iterations, and so far in the last
+        // reported iteration
+        mutable size_t m_main_nodes = 0;
+        mutable size_t m_last_nodes = 0;
+        mutable size_t m_last_depth = 0;
+    };
+
+    // Copies the root position into each helper and starts its thread.
+    void start_helpers(const Bounds bounds, const size_t start_depth) {
+        m_helpers_stopped = false;
+        for (size_t i = 0; i < m_helpers.size(); i++) {
+            Helper &helper = *m_helpers[i];
+
+            // Copy history for repetition detection, then point the
+            // node at the helper's own state.
+            helper.astate = m_node.get().get_astate();
+            helper.node = m_node.get();
+            helper.node.set_astate(helper.astate);
+
+            helper.searcher.new_search();
+            helper.searcher.set_params(m_params);
+            helper.nodes = 0;
+            helper.result.reset();
+            helper.depth_reached = 0;
+            helper.pv.clear();
+
+            const size_t helper_start_depth =
+                std::min(start_depth + ((i + 1) % 2), m_depth);
+            helper.thread = std::thread([this, &helper, bounds,
+                                         helper_start_depth]() {
+                run_helper(helper, bounds, helper_start_depth);
+            });
+        }
+    }
+
+    // Iterative deepening on a helper thread, until stopped.
+    void run_helper(Helper &helper, const Bounds bounds,
+                    const size_t start_depth) {
+        for (size_t depth = start_depth; depth <= m_depth; depth++) {
+            {
+                const std::lock_guard<std::mutex> lock(m_stoplock);
+                if (m_helpers_stopped) {
+                    return;
+                }
+                helper.searcher.set_depth(depth);
+                helper.searching = true;
+            }
+
+            const SearchResult result = helper.searcher.search(bounds);
+
+            {
+                const std::lock_guard<std::mutex> lock(m_stoplock);
+                helper.nodes += helper.searcher.get_node_count();
+                helper.searching = false;
+            }
+
+            if (result.type == SearchResult::LeafType::TIMEOUT) {
+                return;
+            }
+            helper.result = result;
+            helper.depth_reached = depth;
+            helper.searcher.get_pv(helper.pv);
+        }
+    }
+
+    // Stops helpers (but does not join).
+    // Locked so that a helper cannot unstop itself by starting an iteration.
+    void stop_helpers() {
+        const std::lock_guard<std::mutex> lock(m_stoplock);
+        m_helpers_stopped = true;
+        for (const std::unique_ptr<Helper> &helper : m_helpers) {
+            helper->searcher.stop();
+        }
+    }
+
+    // Total nodes searched by helpers since search started.
+    size_t helper_node_count() {
+        const std::lock_guard<std::mutex> lock(m_stoplock);
+        size_t ret = 0;
+        for (const std::unique_ptr<Helper> &helper : m_helpers) {
+            ret += helper->nodes;
+            if (helper->searching) {
+                ret += helper->searcher.get_node_count();
+            }
+        }
+        return ret;
+    }
+
+    std::reference_wrapper<Node> m_node;
+    std::reference_wrapper<TTable> m_ttable;
+
+    IDSearcher<DLNegaMax<TEval, MaxDepth>, MaxDepth> m_main;
+    std::vector<std::unique_ptr<Helper>> m_helpers;
+    size_t m_depth = MaxDepth;
+
+    bool m_helpers_stopped = false;
+    SearchParams m_params{};
+    std::mutex m_stoplock;
+
+    MoveBuffer m_pv;
+};
+
+static_assert(StoppableSearcher<
+              LazySMPSearcher<eval::DefaultEval, default_max_depth>>);
+static_assert(
+    DLSearcher<LazySMPSearcher<eval::DefaultEval, default_max_depth>>);
+
 }  // namespace search
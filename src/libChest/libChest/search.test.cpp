@@ -4,13 +4,18 @@
 
 #include "libChest/search.h"
 
+#include <atomic>
 #include <catch2/catch_test_macros.hpp>
 #include <cstdio>
 #include <iostream>
+#include <map>
+#include <thread>
+#include <utility>
 
 #include "libChest/eval.h"
 #include "libChest/move.h"
 #include "libChest/state.h"
+#include "libChest/timemanagement.h"
 #include "libChest/util.h"
 
 constexpr size_t max_depth = 64;
@@ -20,60 +25,91 @@ constexpr size_t search_depth = 6;
 constexpr size_t search_depth = 7;
 #endif
 
-constexpr static search::NegaMaxOptions VanillaNegaMax = {
-    .prune = false,
-    .sort = false,
-    .quiesce = false,
-    .quiescence_standpat = false,
-    .use_hash = false};
-
-constexpr static search::NegaMaxOptions ABNegaMax = {
-    .prune = true,
-    .sort = false,
-    .quiesce = false,
-    .quiescence_standpat = false,
-    .use_hash = false};
-
-constexpr static search::NegaMaxOptions ABSorted = {
-    .prune = true,
-    .sort = true,
-    .quiesce = false,
-    .quiescence_standpat = false,
-    .use_hash = false};
-
-constexpr static search::NegaMaxOptions QSearch = {.prune = true,
-                                                   .sort = false,
-                                                   .quiesce = true,
-                                                   .quiescence_standpat = false,
-                                                   .use_hash = false};
-
-constexpr static search::NegaMaxOptions QSearchSorted = {
-    .prune = true,
-    .sort = true,
-    .quiesce = true,
-    .quiescence_standpat = false,
-    .use_hash = false};
-
-constexpr static search::NegaMaxOptions QSearchStandPat = {
-    .prune = true,
-    .sort = false,
-    .quiesce = true,
-    .quiescence_standpat = true,
-    .use_hash = false};
-
-constexpr static search::NegaMaxOptions FullQSearch = {
-    .prune = true,
-    .sort = true,
-    .quiesce = true,
-    .quiescence_standpat = true,
-    .use_hash = false};
-
-constexpr static search::NegaMaxOptions FullQSearchWithHashMove = {
-    .prune = true,
-    .sort = true,
-    .quiesce = true,
-    .quiescence_standpat = true,
-    .use_hash = true};
+// Turns off every search feature added since the original options, so
+// that the presets below compare only those.
+constexpr static search::NegaMaxOptions NoNewFeatures = {
+    .null_move = false,
+    .lmr = false,
+    .quiet_checks = false,
+    .delta_pruning = false,
+    .reverse_futility = false,
+    .razoring = false,
+    .futility = false,
+    .late_move_pruning = false,
+    .check_extensions = false,
+    .recapture_extensions = false,
+    .singular_extensions = false,
+    .multi_cut = false,
+    .probcut = false,
+    .iir = false};
+
+// Takes the original options from opts, and the rest from NoNewFeatures.
+constexpr search::NegaMaxOptions with_original(
+    const search::NegaMaxOptions opts) {
+    search::NegaMaxOptions ret = NoNewFeatures;
+    ret.prune = opts.prune;
+    ret.sort = opts.sort;
+    ret.quiesce = opts.quiesce;
+    ret.quiescence_standpat = opts.quiescence_standpat;
+    ret.use_hash = opts.use_hash;
+    return ret;
+}
+
+constexpr static search::NegaMaxOptions VanillaNegaMax = with_original(
+    {.prune = false,
+     .sort = false,
+     .quiesce = false,
+     .quiescence_standpat = false,
+     .use_hash = false});
+
+constexpr static search::NegaMaxOptions ABNegaMax = with_original(
+    {.prune = true,
+     .sort = false,
+     .quiesce = false,
+     .quiescence_standpat = false,
+     .use_hash = false});
+
+constexpr static search::NegaMaxOptions ABSorted = with_original(
+    {.prune = true,
+     .sort = true,
+     .quiesce = false,
+     .quiescence_standpat = false,
+     .use_hash = false});
+
+constexpr static search::NegaMaxOptions QSearch = with_original(
+    {.prune = true,
+     .sort = false,
+     .quiesce = true,
+     .quiescence_standpat = false,
+     .use_hash = false});
+
+constexpr static search::NegaMaxOptions QSearchSorted = with_original(
+    {.prune = true,
+     .sort = true,
+     .quiesce = true,
+     .quiescence_standpat = false,
+     .use_hash = false});
+
+constexpr static search::NegaMaxOptions QSearchStandPat = with_original(
+    {.prune = true,
+     .sort = false,
+     .quiesce = true,
+     .quiescence_standpat = true,
+     .use_hash = false});
+
+constexpr static search::NegaMaxOptions FullQSearch = with_original(
+    {.prune = true,
+     .sort = true,
+     .quiesce = true,
+     .quiescence_standpat = true,
+     .use_hash = false});
+
+constexpr static search::NegaMaxOptions FullQSearchWithHashMove = with_original(
+    {.prune = true,
+     .sort = true,
+     .quiesce = true,
+     .quiescence_standpat = true,
+     .use_hash = true});
 
 template <search::NegaMaxOptions Opts>
 search::SearchResult do_search(auto &searcher, const size_t d,
@@ -148,3 +184,660 @@ TEST_CASE("Equality of equivalent search results.") {
         // NOLINTEND(cppcoreguidelines-avoid-do-while)
     }
 }
+
+TEST_CASE("Transposition table entries round-trip.") {
+    search::TTable ttable(1);
+    const Zobrist idx(0x0123456789ABCDEF);
+    const move::FatMove mv(
+        move::Move(board::Square(12), board::Square(28),
+                   move::MoveType::DOUBLE_PUSH),
+        board::Piece::PAWN);
+    constexpr search::SearchResult::LeafType depth_cutoff =
+        search::SearchResult::LeafType::DEPTH_CUTOFF;
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    REQUIRE(!ttable.contains(idx));
+
+    for (const eval::centipawn_t score : {0, 1, -1, -eval::max_eval}) {
+        for (const search::ABNodeType type :
+             {search::ABNodeType::PV, search::ABNodeType::CUT,
+              search::ABNodeType::ALL}) {
+            ttable.clear();
+            ttable.insert(idx,
+                          {.value = search::IBValue(score, type),
+                           .type = depth_cutoff,
+                           .best_move = mv},
+                          3);
+            const std::optional<search::TTable::TTValue> entry =
+                ttable.at_opt(idx);
+            REQUIRE(entry.has_value());
+            REQUIRE(entry->value.eval() == score);
+            REQUIRE(entry->value.node_type() == type);
+            REQUIRE(entry->depth_remaining == 4);
+            REQUIRE(entry->best_move == mv);
+        }
+    }
+
+    // Shallower results do not overwrite deeper ones within a search,
+    // but do in later searches.
+    ttable.insert(idx, {.type = depth_cutoff, .best_move = {}}, 1);
+    REQUIRE(ttable.at_opt(idx)->best_move == mv);
+    const move::FatMove other_mv(
+        move::Move(board::G1, board::F3, move::MoveType::NORMAL),
+        board::Piece::KNIGHT);
+    ttable.new_search();
+    ttable.insert(idx, {.type = depth_cutoff, .best_move = other_mv}, 1);
+    REQUIRE(ttable.at_opt(idx)->best_move == other_mv);
+
+    // Mate scores are stored relative to the node:
+    // a mate found 5 plies from the root at a node 3 plies from the root
+    // is 4 plies from the root at a node 2 plies from the root.
+    ttable.clear();
+    ttable.insert(idx,
+                  {.value = search::IBValue(eval::mate_score(5),
+                                            search::ABNodeType::PV),
+                   .type = depth_cutoff,
+                   .best_move = mv},
+                  3, 3);
+    REQUIRE(ttable.at_opt(idx, 2)->value.eval() == eval::mate_score(4));
+    REQUIRE(eval::mate_in(eval::mate_score(5)) == 3);
+    REQUIRE(eval::mate_in(-eval::mate_score(4)) == -2);
+
+    // A null best move (e.g. from a terminal node) keeps the existing move.
+    ttable.insert(idx, {.type = depth_cutoff, .best_move = {}}, 3);
+    REQUIRE(ttable.at_opt(idx)->best_move == mv);
+
+    // Different keys in the same (only) bucket do not collide.
+    REQUIRE(!ttable.contains(Zobrist(0x0123456789ABCDEE)));
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+}
+
+TEST_CASE("Move ordering tables record cutoffs.") {
+    search::OrderingTables<max_depth> tables;
+    const board::Colour side = board::Colour::WHITE;
+    const move::FatMove prev(
+        move::Move(board::E7, board::E5, move::MoveType::DOUBLE_PUSH),
+        board::Piece::PAWN);
+    const move::FatMove best(
+        move::Move(board::G1, board::F3, move::MoveType::NORMAL),
+        board::Piece::KNIGHT);
+    const move::FatMove tried(
+        move::Move(board::B1, board::C3, move::MoveType::NORMAL),
+        board::Piece::KNIGHT);
+    MoveBuffer tried_moves;
+    tried_moves.push_back(tried);
+
+    tables.update(1, 4, side, prev, best, tried_moves);
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    REQUIRE(tables.killers(1)[0] == best);
+    REQUIRE(tables.killers(0)[0].is_null());
+    REQUIRE(tables.countermove(side, prev) == best);
+    REQUIRE(tables.countermove(side, {}).is_null());
+    REQUIRE(tables.history().score(side, best) > 0);
+    REQUIRE(tables.history().score(side, tried) < 0);
+    REQUIRE(tables.history().score(!side, best) == 0);
+
+    // Repeated killers are not duplicated
+    tables.update(1, 4, side, prev, best, MoveBuffer{});
+    REQUIRE(tables.killers(1)[1].is_null());
+
+    const int score = tables.history().score(side, best);
+    tables.age();
+    REQUIRE(tables.killers(1)[0].is_null());
+    REQUIRE(tables.history().score(side, best) == score / 2);
+    REQUIRE(tables.countermove(side, prev) == best);
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+}
+
+TEST_CASE("Static exchange evaluation.") {
+    const auto see = [](const state::fen_t &fen, const board::Square from,
+                        const board::Square to, const board::Piece piece) {
+        const state::AugmentedState astate{state::State(fen)};
+        return search::StaticExchange::see(
+            astate, {move::Move(from, to, move::MoveType::CAPTURE), piece});
+    };
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    // Undefended pawn
+    REQUIRE(see("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", board::E1,
+                board::E5, board::Piece::ROOK) == 100);
+
+    // Knight for pawn, with x-rays behind the rook and bishop
+    REQUIRE(see("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1",
+                board::D3, board::E5, board::Piece::KNIGHT) == -200);
+
+    // Defended pawn, but the rook behind recaptures
+    REQUIRE(see("4r1k1/8/8/4p3/8/8/4R3/4R1K1 w - - 0 1", board::E2,
+                board::E5, board::Piece::ROOK) == 100);
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+}
+
+// Illegal moves are filtered before the search sees them, rather than when
+// made. Ties in move ordering may be broken differently, so only results are
+// compared.
+TEST_CASE("Legal move generation gives the same search results.") {
+    static search::TTable ttable;
+    const state::State state(
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    for (size_t d = 1; d < search_depth; d++) {
+        // Fresh searchers, since move ordering tables persist
+        state::AugmentedState pseudo_legal_state{state};
+        search::DefaultNode<eval::DefaultEval, max_depth> pseudo_legal_sn(
+            pseudo_legal_state, max_depth);
+        search::DLNegaMax<eval::DefaultEval, max_depth> pseudo_legal_searcher(
+            pseudo_legal_sn, ttable);
+        const search::SearchResult pseudo_legal =
+            do_search<search::NegaMaxOptions{}>(pseudo_legal_searcher, d,
+                                                "Pseudo-legal", ttable);
+
+        state::AugmentedState legal_state{state};
+        search::DefaultNode<eval::DefaultEval, max_depth> legal_sn(legal_state,
+                                                                   max_depth);
+        search::DLNegaMax<eval::DefaultEval, max_depth> legal_searcher(
+            legal_sn, ttable);
+        const search::SearchResult legal =
+            do_search<search::NegaMaxOptions{.legal_movegen = true}>(
+                legal_searcher, d, "Legal", ttable);
+
+        REQUIRE(legal.value.eval() == pseudo_legal.value.eval());
+        REQUIRE(legal.best_move == pseudo_legal.best_move);
+    }
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+}
+
+TEST_CASE("Principal variation is legal.") {
+    static search::TTable ttable;
+    state::AugmentedState state{state::State(
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1")};
+    search::DefaultNode<eval::DefaultEval, max_depth> sn(state, max_depth);
+    search::DLNegaMax<eval::DefaultEval, max_depth> searcher(sn, ttable);
+
+    const search::SearchResult result =
+        do_search<search::NegaMaxOptions{}>(searcher, search_depth,
+                                            "Default search", ttable);
+    MoveBuffer pv;
+    searcher.get_pv(pv);
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    REQUIRE(pv.size() > 0);
+    REQUIRE(pv[0] == result.best_move);
+    for (const move::FatMove mv : pv) {
+        REQUIRE(move::movegen::AllMoveGenerator::is_pseudo_legal(
+            sn.get_astate(), mv));
+        REQUIRE(sn.make_move(mv));
+    }
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+    sn.unmake_all();
+}
+
+TEST_CASE("Mate scores count plies to mate.") {
+    static search::TTable ttable;
+    state::AugmentedState state{state::State("k7/8/2K5/8/8/8/8/1R6 w - - 0 1")};
+    search::DefaultNode<eval::DefaultEval, max_depth> sn(state, max_depth);
+    search::DLNegaMax<eval::DefaultEval, max_depth> searcher(sn, ttable);
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    for (size_t d = 4; d < search_depth; d++) {
+        const search::SearchResult result = do_search<search::NegaMaxOptions{}>(
+            searcher, d, "Mate in two", ttable);
+        REQUIRE(result.value.eval() == eval::mate_score(3));
+        REQUIRE(eval::mate_in(result.value.eval()) == 2);
+    }
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+}
+
+TEST_CASE("Quiescence search finds quiet checks and evasions.") {
+    // Rxd5 loses to Ra1+ Rd1 Rxd1#, beyond the horizon at depth one
+    static search::TTable ttable;
+    state::AugmentedState state{
+        state::State("r5k1/5ppp/8/3n4/8/8/5PPP/3R2K1 w - - 0 1")};
+    search::DefaultNode<eval::DefaultEval, max_depth> sn(state, max_depth);
+    search::DLNegaMax<eval::DefaultEval, max_depth> searcher(sn, ttable);
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    const search::SearchResult result = do_search<search::NegaMaxOptions{}>(
+        searcher, 1, "Back rank mate", ttable);
+    REQUIRE(static_cast<std::string>(move::LongAlgMove(result.best_move)) !=
+            "d1d5");
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+}
+
+// Records the lines of the last reported depth.
+struct LineRecorder : public search::StatReporter {
+    void report(const size_t depth, const size_t line,
+                const eval::centipawn_t eval, const search::ABNodeType bound,
+                const size_t nodes, const std::chrono::duration<double> time,
+                const MoveBuffer &pv) const override {
+        (void)nodes;
+        (void)time;
+        if (bound != search::ABNodeType::PV) {
+            return;
+        }
+        if (depth != last_depth) {
+            lines.clear();
+            last_depth = depth;
+        }
+        lines.push_back({.line = line, .eval = eval, .pv = pv});
+    }
+
+    void debug_log(const std::string_view &msg) const override { (void)msg; }
+
+    struct Line {
+        size_t line;
+        eval::centipawn_t eval;
+        MoveBuffer pv;
+    };
+
+    mutable size_t last_depth = 0;
+    mutable std::vector<Line> lines;
+};
+
+TEST_CASE("MultiPV lines are distinct and sorted.") {
+    constexpr size_t n_lines = 3;
+    static search::TTable ttable;
+    state::AugmentedState state{state::State(
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1")};
+    search::DefaultNode<eval::DefaultEval, search::default_max_depth> sn(
+        state, search::default_max_depth);
+    search::DefaultSearcher searcher(sn, ttable);
+    searcher.set_depth(search_depth - 1);
+    searcher.set_multipv(n_lines);
+
+    const LineRecorder recorder;
+    const search::SearchResult result = searcher.search({}, &recorder);
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    REQUIRE(recorder.lines.size() == n_lines);
+    REQUIRE(recorder.lines[0].pv[0] == result.best_move);
+    REQUIRE(searcher.get_pv()[0] == result.best_move);
+    for (size_t i = 0; i < n_lines; i++) {
+        REQUIRE(recorder.lines[i].line == i + 1);
+        REQUIRE(recorder.lines[i].pv.size() > 0);
+        for (size_t j = 0; j < i; j++) {
+            REQUIRE(recorder.lines[j].eval >= recorder.lines[i].eval);
+            REQUIRE(recorder.lines[j].pv[0] != recorder.lines[i].pv[0]);
+        }
+    }
+
+    // No lines from a mated root
+    state::AugmentedState mated_state{
+        state::State("R5k1/5ppp/8/8/8/8/8/6K1 b - - 0 1")};
+    search::DefaultNode<eval::DefaultEval, search::default_max_depth>
+        mated_sn(mated_state, search::default_max_depth);
+    search::DefaultSearcher mated_searcher(mated_sn, ttable);
+    mated_searcher.set_multipv(n_lines);
+    REQUIRE(mated_searcher.search().type ==
+            search::SearchResult::LeafType::CHECKMATE);
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+}
+
+TEST_CASE("Search limits.") {
+    static search::TTable ttable;
+    state::AugmentedState state{state::State(
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1")};
+    search::DefaultNode<eval::DefaultEval, search::default_max_depth> sn(
+        state, search::default_max_depth);
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    SECTION("Node-limited search is deterministic") {
+        constexpr size_t node_limit = 50000;
+        std::vector<MoveBuffer> pvs;
+        std::vector<size_t> depths;
+        for (size_t i = 0; i < 2; i++) {
+            ttable.clear();
+            search::DefaultSearcher searcher(sn, ttable);
+            searcher.set_node_limit(node_limit);
+            searcher.search();
+            pvs.push_back(searcher.get_pv());
+            depths.push_back(searcher.get_depth_reached());
+        }
+        REQUIRE(depths[0] == depths[1]);
+        REQUIRE(depths[0] < search::default_max_depth);
+        REQUIRE(std::equal(pvs[0].begin(), pvs[0].end(), pvs[1].begin(),
+                           pvs[1].end()));
+    }
+
+    SECTION("Search moves restrict the root") {
+        ttable.clear();
+        search::DefaultSearcher searcher(sn, ttable);
+        MoveBuffer search_moves;
+        search_moves.push_back(
+            move::LongAlgMove{"a2a3"}.to_fmove(state).value());
+        searcher.set_search_moves(search_moves);
+        searcher.set_depth(search_depth - 1);
+        REQUIRE(searcher.search().best_move == search_moves[0]);
+    }
+
+    SECTION("Mate-limited search stops at the mate") {
+        state::AugmentedState mate_state{
+            state::State("k7/8/2K5/8/8/8/8/1R6 w - - 0 1")};
+        search::DefaultNode<eval::DefaultEval, search::default_max_depth>
+            mate_sn(mate_state, search::default_max_depth);
+        ttable.clear();
+        search::DefaultSearcher searcher(mate_sn, ttable);
+        searcher.set_mate_limit(2);
+        const search::SearchResult result = searcher.search();
+        REQUIRE(eval::mate_in(result.value.eval()) == 2);
+        REQUIRE(searcher.get_depth_reached() <= 4);
+    }
+
+    SECTION("Watchdog stops the search at its deadline") {
+        ttable.clear();
+        search::DefaultSearcher searcher(sn, ttable);
+        search::Watchdog watchdog{[&searcher]() { searcher.stop(); }};
+        const auto start = std::chrono::steady_clock::now();
+        watchdog.set_deadline(start + std::chrono::milliseconds(50));
+        const search::SearchResult result = searcher.search();
+        REQUIRE(std::chrono::steady_clock::now() - start <
+                std::chrono::seconds(5));
+        REQUIRE(!result.best_move.is_null());
+        REQUIRE(searcher.get_depth_reached() >= 1);
+    }
+
+    SECTION("Watchdog deadlines wait for a firing callback") {
+        std::atomic<bool> started = false;
+        std::atomic<bool> finished = false;
+        search::Watchdog watchdog{[&started, &finished]() {
+            started = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            finished = true;
+        }};
+        watchdog.set_deadline(std::chrono::steady_clock::now());
+        while (!started) {
+            std::this_thread::yield();
+        }
+        watchdog.set_deadline({});
+        REQUIRE(finished);
+    }
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+}
+
+TEST_CASE("Dynamic time manager adapts to iterations.") {
+    search::DefaultDynamicTimeManager tm;
+    const board::Colour white = board::Colour::WHITE;
+    const state::AugmentedState state(state::new_game_fen);
+    const move::FatMove e4 = move::LongAlgMove{"e2e4"}.to_fmove(state).value();
+    const move::FatMove d4 = move::LongAlgMove{"d2d4"}.to_fmove(state).value();
+    const auto stats = [](const move::FatMove best, const eval::centipawn_t ev,
+                          const size_t best_move_nodes) {
+        return search::IterationStats{.best_move = best,
+                                      .eval = ev,
+                                      .nodes = 1000,
+                                      .best_move_nodes = best_move_nodes,
+                                      .time = std::chrono::milliseconds(1)};
+    };
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    SECTION("Untimed and pondering searches never stop") {
+        tm.start({}, white);
+        REQUIRE(!tm.hard_deadline().has_value());
+        tm.update(stats(e4, 0, 1000));
+        REQUIRE(!tm.should_stop());
+
+        // Iterations would overrun a 1ms movetime
+        tm.start(search::TimeControl{search::DefaultBuffer + 1}, white, true);
+        tm.update(stats(e4, 0, 1000));
+        tm.update(stats(e4, 0, 1000));
+        REQUIRE(!tm.should_stop());
+        tm.ponderhit();
+        REQUIRE(tm.should_stop());
+    }
+
+    SECTION("Hard limit keeps a reserve of the remaining time") {
+        const auto before = std::chrono::steady_clock::now();
+        tm.start({1000, 1000, 1000, 1000}, white);
+        REQUIRE(tm.hard_deadline().value() <=
+                before + std::chrono::milliseconds(250));
+    }
+
+    SECTION("Soft limit scales with stability, score drops and effort") {
+        const search::TimeControl tc{60000, 60000, 0, 0};
+        tm.start(tc, white);
+        const search::ms_t target = tm.soft_limit();
+
+        tm.update(stats(e4, 0, 900));
+        tm.update(stats(e4, 0, 900));
+        tm.update(stats(e4, 0, 900));
+        const search::ms_t stable = tm.soft_limit();
+        REQUIRE(stable < target);
+
+        tm.update(stats(d4, -50, 300));
+        REQUIRE(tm.soft_limit() > target);
+    }
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+}
+
+// Counts the verbose search messages containing each phrase.
+struct MessageCounter : public search::StatReporter {
+    MessageCounter(const std::initializer_list<std::string_view> phrases) {
+        for (const std::string_view phrase : phrases) {
+            counts[phrase] = 0;
+        }
+    }
+
+    void report(const size_t depth, const size_t line,
+                const eval::centipawn_t eval, const search::ABNodeType bound,
+                const size_t nodes, const std::chrono::duration<double> time,
+                const MoveBuffer &pv) const override {
+        (void)depth;
+        (void)line;
+        (void)eval;
+        (void)bound;
+        (void)nodes;
+        (void)time;
+        (void)pv;
+    }
+
+    void debug_log(const std::string_view &msg) const override {
+        for (auto &[phrase, count] : counts) {
+            if (msg.contains(phrase)) {
+                count++;
+            }
+        }
+    }
+
+    mutable std::map<std::string_view, size_t> counts;
+};
+
+TEST_CASE("Forward pruning fires without losing tactics.") {
+    static search::TTable ttable;
+    constexpr search::NegaMaxOptions no_forward_pruning = {
+        .reverse_futility = false,
+        .razoring = false,
+        .futility = false,
+        .late_move_pruning = false};
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    SECTION("Each rule prunes in a quiet middlegame") {
+        state::AugmentedState state{state::State(
+            "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - "
+            "- 0 10")};
+        search::DefaultNode<eval::DefaultEval, max_depth> sn(state, max_depth);
+        search::DLNegaMax<eval::DefaultEval, max_depth> searcher(sn, ttable);
+
+        const MessageCounter counter({"reverse futility cutoff",
+                                      "razoring cutoff", "futility pruning",
+                                      "late move pruning"});
+        searcher.set_depth(5);
+        searcher.search<search::VerbosityLevel::VERBOSE>({}, &counter);
+        for (const auto &[phrase, count] : counter.counts) {
+            INFO(phrase);
+            REQUIRE(count > 0);
+        }
+        const size_t pruned_nodes = searcher.get_node_count();
+        ttable.clear();
+
+        do_search<no_forward_pruning>(searcher, 5, "No forward pruning",
+                                      ttable);
+        REQUIRE(pruned_nodes < searcher.get_node_count());
+    }
+    SECTION("A mating attack is not pruned") {
+        // Qxh7+ Kxh7 hxg6+ mates
+        state::AugmentedState state{state::State(
+            "r1bq2rk/pp3pbp/2p1p1pQ/7P/3P4/2PB1N2/PP3PPR/2KR4 w - - 0 1")};
+        search::DefaultNode<eval::DefaultEval, max_depth> sn(state, max_depth);
+        search::DLNegaMax<eval::DefaultEval, max_depth> searcher(sn, ttable);
+
+        const search::SearchResult pruned = do_search<search::NegaMaxOptions{}>(
+            searcher, search_depth, "Forward pruning", ttable);
+        const search::SearchResult unpruned = do_search<no_forward_pruning>(
+            searcher, search_depth, "No forward pruning", ttable);
+        REQUIRE(static_cast<std::string>(move::LongAlgMove(
+                    pruned.best_move)) == "h6h7");
+        REQUIRE(eval::is_mate(pruned.value.eval()));
+        REQUIRE(pruned.value.eval() == unpruned.value.eval());
+    }
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+}
+
+TEST_CASE("Extensions find lines beyond the depth limit.") {
+    static search::TTable ttable;
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    SECTION("Check extensions") {
+        // Nf7+ Kg8 Nh6++ Kh8 Qg8+ Rxg8 Nf7# is seven plies, found at depth
+        // six only by extending the checks. Other features are off, so only
+        // the extension changes the search.
+        constexpr size_t depth = 6;
+        constexpr search::NegaMaxOptions extended = [] {
+            search::NegaMaxOptions opts = NoNewFeatures;
+            opts.check_extensions = true;
+            return opts;
+        }();
+        state::AugmentedState state{
+            state::State("r6k/6pp/8/6N1/2Q5/8/6PP/6K1 w - - 0 1")};
+        search::DefaultNode<eval::DefaultEval, max_depth> sn(state, max_depth);
+        search::DLNegaMax<eval::DefaultEval, max_depth> searcher(sn, ttable);
+
+        const search::SearchResult unextended = do_search<NoNewFeatures>(
+            searcher, depth, "Without check extensions", ttable);
+        const search::SearchResult result =
+            do_search<extended>(searcher, depth, "Check extensions", ttable);
+        REQUIRE(static_cast<std::string>(move::LongAlgMove(
+                    result.best_move)) == "g5f7");
+        REQUIRE(result.value.eval() == eval::mate_score(7));
+        REQUIRE(!eval::is_mate(unextended.value.eval()));
+    }
+    SECTION("Singular extensions") {
+        // Qc4+ mates, seen by depth seven only by extending it as singular,
+        // which needs the hash move from earlier iterations. Each search has
+        // its own searcher, since move ordering carries over between
+        // searches.
+        constexpr size_t depth = 7;
+        const state::fen_t fen =
+            "5k2/6pp/p1qN4/1p1p4/3P4/2PKP2Q/PP3r2/3R4 b - - 0 1";
+
+        state::AugmentedState state{state::State(fen)};
+        search::DefaultNode<eval::DefaultEval, max_depth> sn(state, max_depth);
+        search::DLNegaMax<eval::DefaultEval, max_depth> searcher(sn, ttable);
+        search::SearchResult result{};
+        for (size_t d = 1; d <= depth; d++) {
+            searcher.set_depth(d);
+            result = searcher.search<search::NegaMaxOptions{}>();
+        }
+        ttable.clear();
+
+        state::AugmentedState unextended_state{state::State(fen)};
+        search::DefaultNode<eval::DefaultEval, max_depth> unextended_sn(
+            unextended_state, max_depth);
+        search::DLNegaMax<eval::DefaultEval, max_depth> unextended_searcher(
+            unextended_sn, ttable);
+        search::SearchResult unextended{};
+        for (size_t d = 1; d <= depth; d++) {
+            unextended_searcher.set_depth(d);
+            unextended = unextended_searcher.search<search::NegaMaxOptions{
+                .singular_extensions = false, .multi_cut = false}>();
+        }
+        ttable.clear();
+
+        REQUIRE(static_cast<std::string>(move::LongAlgMove(
+                    result.best_move)) == "c6c4");
+        REQUIRE(eval::is_mate(result.value.eval()));
+        REQUIRE(result.value.eval() > 0);
+        REQUIRE(!eval::is_mate(unextended.value.eval()));
+    }
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+}
+
+TEST_CASE("ProbCut and multi-cut fire with tunable margins.") {
+    // Both need hash moves from earlier iterations
+    constexpr size_t depth = 7;
+    static search::TTable ttable;
+    state::AugmentedState state{state::State(
+        "1R6/1brk2p1/4p2p/p1P1Pp2/P7/6P1/1P4P1/2R3K1 w - - 0 1")};
+    search::DefaultNode<eval::DefaultEval, max_depth> sn(state, max_depth);
+    search::DLNegaMax<eval::DefaultEval, max_depth> searcher(sn, ttable);
+
+    const auto count_cuts = [&]() {
+        const MessageCounter counter({"probcut with move", "multi-cut"});
+        search::SearchResult result{};
+        for (size_t d = 1; d <= depth; d++) {
+            searcher.set_depth(d);
+            result = searcher.search<search::VerbosityLevel::VERBOSE>(
+                {}, &counter);
+        }
+        ttable.clear();
+        return std::pair{result, counter.counts};
+    };
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    SECTION("Both cut with the default margins") {
+        const auto [result, counts] = count_cuts();
+        REQUIRE(static_cast<std::string>(move::LongAlgMove(
+                    result.best_move)) == "b8b7");
+        REQUIRE(counts.at("probcut with move") > 0);
+        REQUIRE(counts.at("multi-cut") > 0);
+    }
+    SECTION("Neither cuts with overridden margins") {
+        // No capture beats beta by 100 pawns, and the singular bound
+        // is always below beta
+        const search::SearchParams params = {.probcut_margin = 10000,
+                                             .singular_margin = 10000};
+        searcher.set_params(params);
+        REQUIRE(searcher.get_params().probcut_margin == params.probcut_margin);
+        REQUIRE(searcher.get_params().singular_margin ==
+                params.singular_margin);
+
+        const auto [result, counts] = count_cuts();
+        REQUIRE(counts.at("probcut with move") == 0);
+        REQUIRE(counts.at("multi-cut") == 0);
+    }
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+}
+
+TEST_CASE("Internal iterative reduction leaves a hash move.") {
+    // Kxb2 is the only legal move, so the node after it has no hash move
+    constexpr size_t depth = 7;
+    static search::TTable ttable;
+    state::AugmentedState state{
+        state::State("7k/5ppp/8/8/8/8/1r6/K7 w - - 0 1")};
+    search::DefaultNode<eval::DefaultEval, max_depth> sn(state, max_depth);
+    search::DLNegaMax<eval::DefaultEval, max_depth> searcher(sn, ttable);
+    searcher.set_depth(depth);
+
+    // NOLINTBEGIN(cppcoreguidelines-avoid-do-while)
+    SECTION("Reduced when on") {
+        const search::SearchResult result =
+            searcher.search<search::NegaMaxOptions{}>();
+        REQUIRE(sn.make_move(result.best_move));
+        const auto entry = ttable.at_opt(sn.get<Zobrist>(), 1);
+        REQUIRE(entry.has_value());
+        // Stored as depth + 1, less one for the reduction
+        REQUIRE(entry->depth_remaining == depth - 1);
+        REQUIRE(!entry->best_move.is_null());
+    }
+    SECTION("Not reduced when off") {
+        const search::SearchResult result =
+            searcher.search<search::NegaMaxOptions{.iir = false}>();
+        REQUIRE(sn.make_move(result.best_move));
+        const auto entry = ttable.at_opt(sn.get<Zobrist>(), 1);
+        REQUIRE(entry.has_value());
+        REQUIRE(entry->depth_remaining == depth);
+    }
+    // NOLINTEND(cppcoreguidelines-avoid-do-while)
+    sn.unmake_all();
+    ttable.clear();
+}
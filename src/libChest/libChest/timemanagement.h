@@ -4,7 +4,19 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
 #include "board.h"
+#include "eval.h"
+#include "move.h"
 #include "state.h"
 
 namespace search {
@@ -72,6 +84,35 @@ concept StaticTimeManager =
         { t(tc, to_move) } -> std::same_as<ms_t>;
     };
 
+// Statistics of a completed iteration of iterative deepening.
+struct IterationStats {
+    move::FatMove best_move;
+    eval::centipawn_t eval;
+    // Both from the last search of the root (after any re-searches),
+    // of the first line
+    size_t nodes;
+    size_t best_move_nodes;  // nodes searched below the best root move
+    std::chrono::duration<double> time;
+};
+
+// Stateful time manager, started before a search and fed each completed
+// iteration's stats. The search stops between iterations once should_stop(),
+// and is stopped at the hard deadline (e.g. by a Watchdog) otherwise.
+// Never stops an untimed (null time control) or pondering search.
+template <typename T>
+concept DynamicTimeManager =
+    requires(T t, const TimeControl &tc, const board::Colour to_move,
+             const bool pondering, const IterationStats &stats) {
+        { t.start(tc, to_move, pondering) } -> std::same_as<void>;
+        { t.ponderhit() } -> std::same_as<void>;
+        { t.update(stats) } -> std::same_as<void>;
+        { t.should_stop() } -> std::same_as<bool>;
+        {
+            t.hard_deadline()
+        } -> std::same_as<
+            std::optional<std::chrono::time_point<std::chrono::steady_clock>>>;
+    };
+
 //----------------------------------------------------------------------------//
 // Templates
 //----------------------------------------------------------------------------//
@@ -111,6 +152,149 @@ class SuddenDeathTimeManager {
     TSuddenDeathTimeManager m_suddendeath_mgr{};
 };
 
+// Targets the time given by a static manager (the soft limit), scaled after
+// each iteration by:
+// * best move stability: less time the longer the best move is unchanged,
+// * score drops since the last iteration: more time,
+// * the proportion of nodes spent on the best move: less time if it is high.
+// The hard limit is HardProp times the target, capped at 1/MaxRemainingProp
+// of the remaining time.
+// Iterations predicted to overrun the hard limit (and so be discarded) are not
+// started. Movetime is not scaled, so is only cut short by such iterations.
+template <StaticTimeManager TTargetTimeManager, ms_t HardProp,
+          ms_t MaxRemainingProp, ms_t buffer>
+class StabilityTimeManager {
+   public:
+    using time_point = std::chrono::time_point<std::chrono::steady_clock>;
+
+    void start(const TimeControl &tc, const board::Colour to_move,
+               const bool pondering = false) {
+        m_start = std::chrono::steady_clock::now();
+        m_pondering.store(pondering, std::memory_order::relaxed);
+        m_timed = !tc.is_null();
+        m_scaled = !tc.movetime;
+        m_last_best_move = {};
+        m_last_eval = {};
+        m_stable_iterations = 0;
+        m_last_time = {};
+        m_growth = {};
+
+        const ms_t target = m_target_mgr(tc, to_move);
+        if (tc.movetime) {
+            m_hard = target;
+        } else {
+            const ms_t remaining = tc.copy_remaining(to_move);
+            const ms_t usable = remaining > buffer ? remaining - buffer : 0;
+            m_hard = std::min(target * HardProp, usable / MaxRemainingProp);
+        }
+        m_soft = std::min(target, m_hard);
+        m_scaled_soft = m_soft;
+    }
+
+    // May be called from another thread during search.
+    void ponderhit() { m_pondering.store(false, std::memory_order::relaxed); }
+
+    void update(const IterationStats &stats) {
+        assert(stats.best_move_nodes <= stats.nodes);
+        m_stable_iterations =
+            stats.best_move == m_last_best_move ? m_stable_iterations + 1 : 0;
+        m_last_best_move = stats.best_move;
+
+        if (m_last_time.count() > 0) {
+            m_growth = std::clamp(stats.time / m_last_time, min_growth,
+                                  max_growth);
+        }
+        m_last_time = stats.time;
+
+        ms_t drop = 0;
+        if (m_last_eval.has_value() && !eval::is_mate(stats.eval) &&
+            !eval::is_mate(m_last_eval.value()) &&
+            stats.eval < m_last_eval.value()) {
+            drop = std::min(static_cast<ms_t>(m_last_eval.value() - stats.eval),
+                            max_drop_pct);
+        }
+        m_last_eval = stats.eval;
+
+        const ms_t best_move_pct =
+            stats.nodes ? std::min<ms_t>(stats.best_move_nodes * 100 /
+                                             stats.nodes,
+                                         100)
+                        : 100;
+
+        if (!m_scaled) {
+            return;
+        }
+        const ms_t stability_pct =
+            max_stability_pct -
+            stability_step_pct *
+                std::min<ms_t>(m_stable_iterations, max_stable_iterations);
+        const ms_t drop_pct = 100 + drop;
+        const ms_t effort_pct = max_effort_pct - best_move_pct;
+        m_scaled_soft = std::min(
+            m_soft * stability_pct * drop_pct * effort_pct / (100 * 100 * 100),
+            m_hard);
+    }
+
+    bool should_stop() const {
+        if (!m_timed || m_pondering.load(std::memory_order::relaxed)) {
+            return false;
+        }
+        const std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - m_start;
+        if (elapsed.count() >= static_cast<double>(m_scaled_soft)) {
+            return true;
+        }
+        if (m_growth.has_value()) {
+            const std::chrono::duration<double, std::milli> next =
+                m_last_time * m_growth.value();
+            return (elapsed + next).count() > static_cast<double>(m_hard);
+        }
+        return false;
+    }
+
+    std::optional<time_point> hard_deadline() const {
+        if (!m_timed) {
+            return {};
+        }
+        return m_start + std::chrono::milliseconds(m_hard);
+    }
+
+    // Current soft limit, in ms since start().
+    ms_t soft_limit() const { return m_scaled_soft; }
+
+   private:
+    TTargetTimeManager m_target_mgr{};
+
+    time_point m_start{};
+    std::atomic<bool> m_pondering = false;
+    bool m_timed = false;
+    bool m_scaled = false;
+    ms_t m_soft = 0;
+    ms_t m_scaled_soft = 0;
+    ms_t m_hard = 0;
+
+    move::FatMove m_last_best_move{};
+    std::optional<eval::centipawn_t> m_last_eval{};
+    size_t m_stable_iterations = 0;
+    std::chrono::duration<double> m_last_time{};
+    std::optional<double> m_growth{};
+
+    // Soft limit scaled by 130% down to 70% as the best move stabilises
+    static constexpr ms_t max_stability_pct = 130;
+    static constexpr ms_t stability_step_pct = 10;
+    static constexpr ms_t max_stable_iterations = 6;
+
+    // +1% per centipawn dropped
+    static constexpr ms_t max_drop_pct = 100;
+
+    // 150% less the percentage of nodes spent on the best move
+    static constexpr ms_t max_effort_pct = 150;
+
+    // Iteration times are predicted to grow as they last did
+    static constexpr double min_growth = 1.0;
+    static constexpr double max_growth = 4.0;
+};
+
 //----------------------------------------------------------------------------//
 // Concrete instances
 //----------------------------------------------------------------------------//
@@ -124,5 +308,90 @@ using DefaultTimeManager = search::SuddenDeathTimeManager<
     search::EqualTimeManager<DefaultRemainingProp, DefaultIncProp>,
     EqualTimeManager<DefaultSuddenDeathProp, 1>, DefaultBuffer>;
 
+static constexpr ms_t DefaultHardProp = 3;
+static constexpr ms_t DefaultMaxRemainingProp = 5;
+
+using DefaultDynamicTimeManager =
+    StabilityTimeManager<DefaultTimeManager, DefaultHardProp,
+                         DefaultMaxRemainingProp, DefaultBuffer>;
+
+//============================================================================//
+// Timers
+//============================================================================//
+
+// Runs a callback once a deadline passes, from its own thread, which sleeps
+// until then. Lets searches stop on time without polling the clock.
+// The deadline may be moved or cleared at any time (e.g. on ponderhit).
+class Watchdog {
+   public:
+    using time_point = std::chrono::time_point<std::chrono::steady_clock>;
+
+    explicit Watchdog(std::function<void()> on_expiry)
+        : m_on_expiry(std::move(on_expiry)), m_thread([this]() { run(); }) {}
+
+    Watchdog(const Watchdog &) = delete;
+    Watchdog(Watchdog &&) = delete;
+    Watchdog &operator=(const Watchdog &) = delete;
+    Watchdog &operator=(Watchdog &&) = delete;
+
+    ~Watchdog() {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_shutdown = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+    }
+
+    // Replaces any pending deadline, none if empty.
+    // Waits for a firing callback to return, so it cannot act on whatever
+    // the caller does next (unless called from the callback itself).
+    void set_deadline(const std::optional<time_point> deadline) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (std::this_thread::get_id() != m_thread.get_id()) {
+                m_fired.wait(lock, [this]() { return !m_firing; });
+            }
+            m_deadline = deadline;
+        }
+        m_cv.notify_one();
+    }
+
+   private:
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_shutdown) {
+            if (!m_deadline.has_value()) {
+                m_cv.wait(lock);
+            } else if (std::chrono::steady_clock::now() < m_deadline.value()) {
+                m_cv.wait_until(lock, m_deadline.value());
+            } else {
+                // Fire once, unlocked so the callback may set a new deadline
+                m_deadline.reset();
+                m_firing = true;
+                lock.unlock();
+                m_on_expiry();
+                lock.lock();
+                m_firing = false;
+                m_fired.notify_all();
+            }
+        }
+    }
+
+    std::function<void()> m_on_expiry;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::optional<time_point> m_deadline{};
+    bool m_shutdown = false;
+
+    // Set while the callback runs
+    bool m_firing = false;
+    std::condition_variable m_fired;
+
+    // Last, so it starts after the other members are initialised
+    std::thread m_thread;
+};
+
 }  // namespace search
 static_assert(search::StaticTimeManager<search::DefaultTimeManager>);
+static_assert(search::DynamicTimeManager<search::DefaultDynamicTimeManager>);
@@ -99,3 +99,35 @@ struct tuple_has;
 template <typename T, typename... Us>
 struct tuple_has<T, std::tuple<Us...>>
     : std::disjunction<std::is_same<T, Us>...> {};
+
+//============================================================================//
+// Compile-time maths
+//============================================================================//
+
+// Natural logarithm of a positive number, usable in constant expressions
+// (std::log is not constexpr until C++26).
+constexpr double constexpr_ln(double x) {
+    constexpr double ln_2 = 0.6931471805599453;
+    constexpr int n_terms = 20;
+
+    // Reduce to [1, 2)
+    int exponent = 0;
+    while (x >= 2) {
+        x /= 2;
+        exponent++;
+    }
+    while (x < 1) {
+        x *= 2;
+        exponent--;
+    }
+
+    // ln(x) = 2 * atanh((x - 1) / (x + 1))
+    const double y = (x - 1) / (x + 1);
+    double term = y;
+    double ret = 0;
+    for (int i = 0; i < n_terms; i++) {
+        ret += term / ((2 * i) + 1);
+        term *= y * y;
+    }
+    return (2 * ret) + (exponent * ln_2);
+}